@@ -0,0 +1,65 @@
+// src/arena.hpp
+//bump allocator for the AST: nodes are carved out of big blocks one after the other and are all
+//released together when the arena goes away, instead of one heap allocation (and refcount) per node
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+class AstArena {
+public:
+    AstArena() = default;
+    AstArena(const AstArena &) = delete;
+    AstArena &operator=(const AstArena &) = delete;
+    ~AstArena() {
+        // nodes may own strings or vectors, run their destructors (newest first) before the blocks go
+        for (auto it = destructors.rbegin(); it != destructors.rend(); ++it) it->second(it->first);
+    }
+
+    template <class T, class... Args>
+    T *make(Args &&...args) {
+        T *obj = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        if (!std::is_trivially_destructible<T>::value)
+            destructors.emplace_back(obj, [](void *p) { static_cast<T *>(p)->~T(); });
+        return obj;
+    }
+
+    //copy of items that lives as long as the arena
+    template <class T>
+    T *copyArray(const std::vector<T> &items) {
+        static_assert(std::is_trivially_copyable<T>::value, "only plain data can be copied into the arena");
+        if (items.empty()) return nullptr;
+        T *out = static_cast<T *>(allocate(sizeof(T) * items.size(), alignof(T)));
+        for (size_t i = 0; i < items.size(); ++i) out[i] = items[i];
+        return out;
+    }
+
+    size_t bytesUsed() const { return used; }
+
+private:
+    static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+    std::vector<std::unique_ptr<char[]>> blocks;
+    char *cursor = nullptr;
+    char *limit = nullptr;
+    size_t used = 0;
+    std::vector<std::pair<void *, void (*)(void *)>> destructors;
+
+    void *allocate(size_t size, size_t align) {
+        uintptr_t p = ((uintptr_t)cursor + align - 1) & ~(uintptr_t)(align - 1);
+        if (!cursor || p + size > (uintptr_t)limit) {
+            size_t blockSize = size + align > BLOCK_SIZE ? size + align : BLOCK_SIZE;
+            blocks.emplace_back(new char[blockSize]);
+            cursor = blocks.back().get();
+            limit = cursor + blockSize;
+            p = ((uintptr_t)cursor + align - 1) & ~(uintptr_t)(align - 1);
+        }
+        cursor = (char *)(p + size);
+        used += size;
+        return (void *)p;
+    }
+};
@@ -2,8 +2,12 @@
 //This is Abstract syntax tree 
 #pragma once
 #include <string>
+#include <string_view>
 #include <vector>
 #include <memory>
+#include "arena.hpp"
+#include "symbol.hpp"
+#include "value.hpp"
 
 enum class ASTNodeType {
     PRINT_STMT,
@@ -14,6 +18,7 @@ enum class ASTNodeType {
     IDENT,
     NUMBER,
     STRING,
+    BOOL,
     BINARY_EXPR,
     UNARY_EXPR,
     INDEX_EXPR,
@@ -24,17 +29,67 @@ enum class ASTNodeType {
     NEW_OBJECT_EXPR,
     METHOD_CALL_EXPR,
     ARRAY_LITERAL,
-    MEMBER_ACCESS_EXPR
+    MEMBER_ACCESS_EXPR,
+    MEMBER_ASSIGN_STMT,
+    LOOP_STMT,
+    COUNTED_LOOP_STMT,
+    BREAK_STMT,
+    CONTINUE_STMT,
+    DICT_LITERAL,
+    INDEX_ASSIGN_STMT
 };
 
 
+// Nodes live in the AstArena of their Script and point at their children with plain pointers,
+// none of them is ever freed on its own.
 struct ASTNode {
     ASTNodeType type;
-    virtual ~ASTNode() = default;
+};
+
+// children of a node: an array of node pointers allocated in the same arena
+template <class T = ASTNode>
+struct NodeList {
+    T **items = nullptr;
+    uint32_t count = 0;
+
+    T **begin() const { return items; }
+    T **end() const { return items + count; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    T *operator[](size_t i) const { return items[i]; }
+};
+
+//copies items into the arena as the children of a node
+template <class T>
+NodeList<T> makeList(AstArena &arena, const std::vector<T *> &items) {
+    NodeList<T> l;
+    l.items = arena.copyArray(items);
+    l.count = (uint32_t)items.size();
+    return l;
+}
+
+// what the Parser hands over: the top level statements and the arena owning every node.
+// Everything the engines keep pointing at (functions, classes) stays valid while the Script lives.
+// drip bodies are only parsed on their first call, so the source text has to outlive the Script too.
+struct Script {
+    std::unique_ptr<AstArena> arena = std::make_unique<AstArena>();
+    NodeList<> statements;
+};
+
+// source a deferred drip body is parsed from, one per Script, allocated in its arena
+struct DeferredSource {
+    std::string_view text;
+    AstArena *arena;   // where the nodes of the body go
+};
+
+// where a variable lives, filled in by the Resolver: a slot of the current call frame or a global slot
+struct VarRef {
+    bool local = false;
+    int slot = -1;
 };
 struct ExprStmt : public ASTNode {
-    std::shared_ptr<ASTNode> expr;
-    ExprStmt(std::shared_ptr<ASTNode> e) { 
+    ASTNode *expr;
+    ExprStmt(ASTNode *e) { 
         type = ASTNodeType::EXPR_STMT; 
         expr = e; 
     }
@@ -42,14 +97,15 @@ struct ExprStmt : public ASTNode {
 
 // Print statement → bruh "hello"
 struct PrintStmt : public ASTNode {
-    std::shared_ptr<ASTNode> value;
-    PrintStmt(std::shared_ptr<ASTNode> v) { 
+    ASTNode *value;
+    PrintStmt(ASTNode *v) { 
         type = ASTNodeType::PRINT_STMT; 
         value = v; 
     }
 };
 struct InputStmt : public ASTNode {
     std::string varName;
+    VarRef ref;
     InputStmt(const std::string& var) {
         type = ASTNodeType::INPUT_STMT;  // 👈 important
         varName = var;
@@ -59,8 +115,9 @@ struct InputStmt : public ASTNode {
 // Assignment → x = 10
 struct AssignStmt : public ASTNode {
     std::string name;
-    std::shared_ptr<ASTNode> value;
-    AssignStmt(const std::string& n, std::shared_ptr<ASTNode> v) {
+    ASTNode *value;
+    VarRef ref;
+    AssignStmt(const std::string& n, ASTNode *v) {
         type = ASTNodeType::ASSIGN_STMT;
         name = n;
         value = v;
@@ -69,13 +126,13 @@ struct AssignStmt : public ASTNode {
 
 // If statement → sus x > 5: ...
 struct IfStmt : public ASTNode {
-    std::shared_ptr<ASTNode> condition;                     // nullptr means ELSE
-    std::vector<std::shared_ptr<ASTNode>> thenBranch;       // body of this branch
-    std::shared_ptr<IfStmt> next;                           // chained else-if or else
+    ASTNode *condition;     // nullptr means ELSE
+    NodeList<> thenBranch;  // body of this branch
+    IfStmt *next;           // chained else-if or else
 
-    IfStmt(std::shared_ptr<ASTNode> cond,
-           std::vector<std::shared_ptr<ASTNode>> thenB,
-           std::shared_ptr<IfStmt> nextNode = nullptr)
+    IfStmt(ASTNode *cond,
+           NodeList<> thenB,
+           IfStmt *nextNode = nullptr)
         : condition(std::move(cond)),
           thenBranch(std::move(thenB)),
           next(std::move(nextNode)) {
@@ -83,6 +140,40 @@ struct IfStmt : public ASTNode {
     }
 };
 
+// While loop → loop x < 5: ... periodt
+struct LoopStmt : public ASTNode {
+    ASTNode *condition;
+    NodeList<> body;
+
+    LoopStmt(ASTNode *cond, NodeList<> b) : condition(cond), body(b) {
+        type = ASTNodeType::LOOP_STMT;
+    }
+};
+
+// Counted loop → loop i = 0, 10: ... periodt   (0 up to 9, an optional third value is the step)
+// from, to and step are evaluated once before the first iteration
+struct CountedLoopStmt : public ASTNode {
+    std::string varName;
+    VarRef ref;
+    ASTNode *from;
+    ASTNode *to;
+    ASTNode *step;     // nullptr means 1
+    NodeList<> body;
+
+    CountedLoopStmt(const std::string &var, ASTNode *f, ASTNode *t, ASTNode *s, NodeList<> b)
+        : varName(var), from(f), to(t), step(s), body(b) {
+        type = ASTNodeType::COUNTED_LOOP_STMT;
+    }
+};
+
+// sybau (break) and yeet (continue)
+struct BreakStmt : public ASTNode {
+    BreakStmt() { type = ASTNodeType::BREAK_STMT; }
+};
+struct ContinueStmt : public ASTNode {
+    ContinueStmt() { type = ASTNodeType::CONTINUE_STMT; }
+};
+
 // Literals (numbers, strings, identifiers)
 struct NumberExpr : public ASTNode {
     double value;
@@ -90,41 +181,67 @@ struct NumberExpr : public ASTNode {
 };
 
 struct StringExpr : public ASTNode {
-    std::string value;
-    StringExpr(const std::string& v) { type = ASTNodeType::STRING; value = v; }
+    Value value;   // interned once here, evaluating the literal just shares it
+    StringExpr(const std::string& v) { type = ASTNodeType::STRING; value = internString(v); }
+};
+
+// no_cap/cap as a value, only made by the Optimizer (the parser reads them as 1 and 0)
+struct BoolExpr : public ASTNode {
+    bool value;
+    BoolExpr(bool v) { type = ASTNodeType::BOOL; value = v; }
 };
 
 struct IdentExpr : public ASTNode {
     std::string name;
+    VarRef ref;
     IdentExpr(const std::string& n) { type = ASTNodeType::IDENT; name = n; }
 };
 
+enum class BinaryOp : uint8_t { ADD, SUB, MUL, DIV, MOD, GT, LT, GE, LE, EQ, NEQ, OTHER };
+
+inline BinaryOp binaryOpFor(const std::string &op) {
+    static const char *const names[] = {"+", "-", "*", "/", "%", ">", "<", ">=", "<=", "==", "!="};
+    for (int i = 0; i < (int)BinaryOp::OTHER; ++i)
+        if (op == names[i]) return (BinaryOp)i;
+    return BinaryOp::OTHER;
+}
+
+// How the Interpreter runs a BinaryExpr, learned from the operands it met: UNSEEN until it first
+// ran on two numbers, from then on the numeric form of its operator (same order as BinaryOp), and
+// GENERIC for good once a quickened node met something else. Only the Interpreter looks at it.
+enum class QuickOp : uint8_t { NUM_ADD, NUM_SUB, NUM_MUL, NUM_DIV, NUM_MOD, NUM_GT, NUM_LT, NUM_GE, NUM_LE,
+                               NUM_EQ, NUM_NEQ, UNSEEN, GENERIC };
+
 // Binary expression (x > 5)
 struct BinaryExpr : public ASTNode {
-    std::shared_ptr<ASTNode> left;
+    ASTNode *left;
     std::string op;
-    std::shared_ptr<ASTNode> right;
-    BinaryExpr(std::shared_ptr<ASTNode> l, const std::string& o, std::shared_ptr<ASTNode> r) {
+    ASTNode *right;
+    BinaryOp opcode;                    // op decoded once, nothing compares the string at runtime
+    QuickOp quick = QuickOp::UNSEEN;
+
+    BinaryExpr(ASTNode *l, const std::string& o, ASTNode *r) {
         type = ASTNodeType::BINARY_EXPR;
         left = l; op = o; right = r;
+        opcode = binaryOpFor(o);
     }
 };
 
 struct UnaryExpr : public ASTNode {
     std::string op;  // e.g. "!"
-    std::shared_ptr<ASTNode> operand;
+    ASTNode *operand;
 
-    UnaryExpr(const std::string& op, std::shared_ptr<ASTNode> operand)
+    UnaryExpr(const std::string& op, ASTNode *operand)
         : op(op), operand(std::move(operand)) {
         type = ASTNodeType::UNARY_EXPR;
     }
 };
 
 struct IndexExpr : public ASTNode {
-    std::shared_ptr<ASTNode> target; // the array/string being indexed
-    std::shared_ptr<ASTNode> index;  // the index expression
+    ASTNode *target; // the array/string being indexed
+    ASTNode *index;  // the index expression
 
-    IndexExpr(std::shared_ptr<ASTNode> t, std::shared_ptr<ASTNode> i) {
+    IndexExpr(ASTNode *t, ASTNode *i) {
         type = ASTNodeType::INDEX_EXPR; // or better: add ASTNodeType::INDEX_EXPR
         target = std::move(t);
         index = std::move(i);
@@ -133,14 +250,29 @@ struct IndexExpr : public ASTNode {
 // Function definition → drip foo(x, y): ...
 struct FuncDef : public ASTNode {
     std::string name;
+    Symbol symbol;
     std::vector<std::string> params;
-    std::vector<std::shared_ptr<ASTNode>> body;
+    NodeList<> body;
+
+    // frame layout from the Resolver: params first, then self for methods, then assigned names
+    int numLocals = 0;
+    int selfSlot = -1;
+    std::vector<int> localGlobals;   // global slot each local shadows, read while the local is still unset
+
+    bool isMethod = false;           // set by the ClassDef holding it
+
+    // until the first call only the source range of the body is known (body is empty),
+    // parseDeferredBody parses it and clears deferred
+    const DeferredSource *deferred = nullptr;
+    size_t bodyStart = 0;
+    size_t bodyEnd = 0;
 
     FuncDef(const std::string &n,
             std::vector<std::string> p,
-            std::vector<std::shared_ptr<ASTNode>> b) {
+            NodeList<> b) {
         type = ASTNodeType::FUNC_DEF;
         name = n;
+        symbol = internSymbol(n);
         params = std::move(p);
         body = std::move(b);
     }
@@ -149,19 +281,22 @@ struct FuncDef : public ASTNode {
 // Function call → foo(42, "yo")
 struct CallExpr : public ASTNode {
     std::string callee;
-    std::vector<std::shared_ptr<ASTNode>> args;
+    Symbol calleeSymbol;
+    NodeList<> args;
+    VarRef calleeVar;   // used when callee is an object variable rather than a function
 
-    CallExpr(const std::string &c, std::vector<std::shared_ptr<ASTNode>> a) {
+    CallExpr(const std::string &c, NodeList<> a) {
         type = ASTNodeType::CALL_EXPR;
         callee = c;
+        calleeSymbol = internSymbol(c);
         args = std::move(a);
     }
 };
 
 // Return statement
 struct ReturnStmt : public ASTNode {
-    std::shared_ptr<ASTNode> value;
-    ReturnStmt(std::shared_ptr<ASTNode> v) {
+    ASTNode *value;
+    ReturnStmt(ASTNode *v) {
         type = ASTNodeType::RETURN_STMT;
         value = v;
     }
@@ -170,21 +305,26 @@ struct ReturnStmt : public ASTNode {
 // Class definition → rizz MyClass: ...
 struct ClassDef : public ASTNode {
     std::string name;
-    std::vector<std::shared_ptr<FuncDef>> methods;
+    Symbol symbol;
+    NodeList<FuncDef> methods;
 
-    ClassDef(const std::string &n, std::vector<std::shared_ptr<FuncDef>> m) {
+    ClassDef(const std::string &n, NodeList<FuncDef> m) {
         type = ASTNodeType::CLASS_DEF;
         name = n;
+        symbol = internSymbol(n);
         methods = std::move(m);
+        for (auto fn : methods) fn->isMethod = true;
     }
 };
 struct NewObjectExpr : public ASTNode {
     std::string className;
-    std::vector<std::shared_ptr<ASTNode>> args;
+    Symbol classSymbol;
+    NodeList<> args;
 
-    NewObjectExpr(const std::string &c, std::vector<std::shared_ptr<ASTNode>> a) {
+    NewObjectExpr(const std::string &c, NodeList<> a) {
         type = ASTNodeType::NEW_OBJECT_EXPR;
         className = c;
+        classSymbol = internSymbol(c);
         args = std::move(a);
     }
 };
@@ -192,38 +332,96 @@ struct NewObjectExpr : public ASTNode {
 // Method call → obj.method(args...)
 // Represents x.y (property access)
 struct MemberAccessExpr : public ASTNode {
-    std::shared_ptr<ASTNode> object;  // the "x"
+    ASTNode *object;  // the "x"
     std::string member;               // the "y"
+    Symbol memberSymbol;
+    InlineCache cache;
 
-    MemberAccessExpr(std::shared_ptr<ASTNode> obj, const std::string &mem) {
+    MemberAccessExpr(ASTNode *obj, const std::string &mem) {
         type = ASTNodeType::MEMBER_ACCESS_EXPR;
         object = std::move(obj);
         member = mem;
+        memberSymbol = internSymbol(mem);
     }
 };
 
 // Represents x.func(args...)
 struct MethodCallExpr : public ASTNode {
-    std::shared_ptr<ASTNode> object;  // the "x"
+    ASTNode *object;  // the "x"
     std::string method;               // the "func"
-    std::vector<std::shared_ptr<ASTNode>> arguments;
+    Symbol methodSymbol;
+    NodeList<> arguments;
+    InlineCache cache;
 
-    MethodCallExpr(std::shared_ptr<ASTNode> obj,
+    MethodCallExpr(ASTNode *obj,
                    const std::string &meth,
-                   std::vector<std::shared_ptr<ASTNode>> args) {
+                   NodeList<> args) {
         type = ASTNodeType::METHOD_CALL_EXPR;
         object = std::move(obj);
         method = meth;
+        methodSymbol = internSymbol(meth);
         arguments = std::move(args);
     }
 };
+// Field assignment → x.y = 10
+struct MemberAssignStmt : public ASTNode {
+    ASTNode *object;
+    std::string member;
+    Symbol memberSymbol;
+    ASTNode *value;
+    InlineCache cache;
+
+    MemberAssignStmt(ASTNode *obj, const std::string &mem, ASTNode *v) {
+        type = ASTNodeType::MEMBER_ASSIGN_STMT;
+        object = obj;
+        member = mem;
+        memberSymbol = internSymbol(mem);
+        value = v;
+    }
+};
+// Index assignment → d["a"] = 1, a[i] = v
+struct IndexAssignStmt : public ASTNode {
+    ASTNode *target;
+    ASTNode *index;
+    ASTNode *value;
+
+    IndexAssignStmt(ASTNode *t, ASTNode *i, ASTNode *v) {
+        type = ASTNodeType::INDEX_ASSIGN_STMT;
+        target = t;
+        index = i;
+        value = v;
+    }
+};
+
+// a literal number or a variable: evaluating it runs no code and moves nothing, so a reference
+// taken before it is still good after it
+inline bool isSimpleOperand(const ASTNode *node) {
+    return node->type == ASTNodeType::NUMBER || node->type == ASTNodeType::IDENT;
+}
+
+// Whether node names where a value is stored: a variable, a field, or an item reached from one
+// of those (grid[i], self.rows[i][j]). a[i] = v and a.push(v) change the array stored there in
+// place, on anything else they only change a temporary.
+inline bool isPlace(const ASTNode *node) {
+    while (node->type == ASTNodeType::INDEX_EXPR) node = static_cast<const IndexExpr *>(node)->target;
+    return node->type == ASTNodeType::IDENT || node->type == ASTNodeType::MEMBER_ACCESS_EXPR;
+}
 struct ArrayLiteral : ASTNode {
-    std::vector<std::shared_ptr<ASTNode>> elements;
+    NodeList<> elements;
 
     ArrayLiteral() { type = ASTNodeType::ARRAY_LITERAL; }
-    ArrayLiteral(const std::vector<std::shared_ptr<ASTNode>>& elems)
+    ArrayLiteral(NodeList<> elems)
         : elements(elems)
     {
         type = ASTNodeType::ARRAY_LITERAL;
     }
-};
\ No newline at end of file
+};
+// Dict literal → {"a": 1, "b": 2}, keys[i] goes with values[i]
+struct DictLiteral : ASTNode {
+    NodeList<> keys;
+    NodeList<> values;
+
+    DictLiteral(NodeList<> k, NodeList<> v) : keys(k), values(v) {
+        type = ASTNodeType::DICT_LITERAL;
+    }
+};
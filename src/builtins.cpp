@@ -0,0 +1,375 @@
+// src/builtins.cpp
+//the array builtins read the items of a numeric array straight as packed doubles (see
+//ArrayObj::numeric()) and go through them with AVX2 when the cpu has it, SSE2 or NEON otherwise,
+//and plain loops where neither exists (wasm) or for the last few items.
+//
+//every kernel of a reduction (sum, min, max, dot) goes through the items in the same order, so the
+//result is the same to the last bit on every cpu: four lanes, lane j takes the items 4k + j of the
+//full blocks of four, then (lane0 op lane1) op (lane2 op lane3), then the items left over one by
+//one. Floating point addition isn't associative, any other grouping would round differently.
+//The build turns off fused multiply-add for this file, it would round dot differently too.
+#include "builtins.hpp"
+#include "dict.hpp"
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define RIZZ_SSE2 1
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define RIZZ_NEON 1
+#endif
+
+// AVX2 code is only compiled for the functions marked with it and picked at runtime,
+// so the same binary still runs on cpus without it
+#if (defined(__GNUC__) || defined(__clang__)) && !defined(_MSC_VER) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define RIZZ_AVX2 1
+#define RIZZ_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+enum class Reduce { SUM, MIN, MAX };
+enum class Map { ADD, MUL };
+
+// --- plain loops, also used for the items left over after the last full vector ---
+
+template <Reduce op>
+static inline double combine(double acc, double x) {
+    if (op == Reduce::SUM) return acc + x;
+    if (op == Reduce::MIN) return x < acc ? x : acc;
+    return x > acc ? x : acc;
+}
+
+//what a reduction starts from, min and max need at least one item
+template <Reduce op>
+static inline double identity(const Value *a) {
+    return op == Reduce::SUM ? 0.0 : a[0].asNumber();
+}
+
+template <Reduce op>
+static double reduceFrom(const Value *a, size_t i, size_t n, double acc) {
+    for (; i < n; ++i) acc = combine<op>(acc, a[i].asNumber());
+    return acc;
+}
+
+static double dotFrom(const Value *a, const Value *b, size_t i, size_t n, double acc) {
+    for (; i < n; ++i) acc += a[i].asNumber() * b[i].asNumber();
+    return acc;
+}
+
+//where the four lanes end up, see the top of the file
+template <Reduce op>
+static inline double combineLanes(double l0, double l1, double l2, double l3) {
+    return combine<op>(combine<op>(l0, l1), combine<op>(l2, l3));
+}
+
+template <Map op>
+static inline double apply(double x, double y) {
+    return op == Map::ADD ? x + y : x * y;
+}
+
+//out[i] = a[i] op b[i], every b[i] is k when b is nullptr
+template <Map op>
+static void mapFrom(const Value *a, const Value *b, double k, Value *out, size_t i, size_t n) {
+    for (; i < n; ++i) out[i] = apply<op>(a[i].asNumber(), b ? b[i].asNumber() : k);
+}
+
+// Vector results are stored into the Values directly, so NaNs are first turned into the one NaN
+// Value(double) would have made of them: the sign and payload the cpu leaves could read as a tag.
+
+// --- two lanes: SSE2 on x86, NEON on arm64 ---
+
+#if defined(RIZZ_SSE2) || defined(RIZZ_NEON)
+#define RIZZ_PAIRS 1
+
+#ifdef RIZZ_SSE2
+using Pair = __m128d;
+static inline Pair loadPair(const Value *p) { return _mm_loadu_pd(reinterpret_cast<const double *>(p)); }
+static inline Pair splatPair(double d) { return _mm_set1_pd(d); }
+static inline Pair addPair(Pair a, Pair b) { return _mm_add_pd(a, b); }
+static inline Pair mulPair(Pair a, Pair b) { return _mm_mul_pd(a, b); }
+static inline Pair minPair(Pair x, Pair acc) { return _mm_min_pd(x, acc); }   // x < acc ? x : acc
+static inline Pair maxPair(Pair x, Pair acc) { return _mm_max_pd(x, acc); }
+static inline double lane(Pair v, int i) { return _mm_cvtsd_f64(i ? _mm_unpackhi_pd(v, v) : v); }
+static inline void storePair(Value *p, Pair v) {
+    Pair nan = _mm_cmpunord_pd(v, v);
+    v = _mm_or_pd(_mm_andnot_pd(nan, v), _mm_and_pd(nan, _mm_set1_pd(std::numeric_limits<double>::quiet_NaN())));
+    _mm_storeu_pd(reinterpret_cast<double *>(p), v);
+}
+#else
+using Pair = float64x2_t;
+static inline Pair loadPair(const Value *p) { return vld1q_f64(reinterpret_cast<const double *>(p)); }
+static inline Pair splatPair(double d) { return vdupq_n_f64(d); }
+static inline Pair addPair(Pair a, Pair b) { return vaddq_f64(a, b); }
+static inline Pair mulPair(Pair a, Pair b) { return vmulq_f64(a, b); }
+static inline Pair minPair(Pair x, Pair acc) { return vbslq_f64(vcltq_f64(x, acc), x, acc); }
+static inline Pair maxPair(Pair x, Pair acc) { return vbslq_f64(vcgtq_f64(x, acc), x, acc); }
+static inline double lane(Pair v, int i) { return i ? vgetq_lane_f64(v, 1) : vgetq_lane_f64(v, 0); }
+static inline void storePair(Value *p, Pair v) {
+    v = vbslq_f64(vceqq_f64(v, v), v, vdupq_n_f64(std::numeric_limits<double>::quiet_NaN()));
+    vst1q_f64(reinterpret_cast<double *>(p), v);
+}
+#endif
+
+template <Reduce op>
+static inline Pair combinePair(Pair acc, Pair x) {
+    if (op == Reduce::SUM) return addPair(acc, x);
+    if (op == Reduce::MIN) return minPair(x, acc);
+    return maxPair(x, acc);
+}
+
+//lanes 0 and 1 in lo, 2 and 3 in hi
+template <Reduce op>
+static double reducePairs(const Value *a, size_t n) {
+    Pair lo = splatPair(identity<op>(a));
+    Pair hi = lo;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        lo = combinePair<op>(lo, loadPair(a + i));
+        hi = combinePair<op>(hi, loadPair(a + i + 2));
+    }
+    return reduceFrom<op>(a, i, n, combineLanes<op>(lane(lo, 0), lane(lo, 1), lane(hi, 0), lane(hi, 1)));
+}
+
+static double dotPairs(const Value *a, const Value *b, size_t n) {
+    Pair lo = splatPair(0.0);
+    Pair hi = lo;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        lo = addPair(lo, mulPair(loadPair(a + i), loadPair(b + i)));
+        hi = addPair(hi, mulPair(loadPair(a + i + 2), loadPair(b + i + 2)));
+    }
+    return dotFrom(a, b, i, n, combineLanes<Reduce::SUM>(lane(lo, 0), lane(lo, 1), lane(hi, 0), lane(hi, 1)));
+}
+
+template <Map op>
+static void mapPairs(const Value *a, const Value *b, double k, Value *out, size_t n) {
+    Pair kk = splatPair(k);
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        Pair x = loadPair(a + i);
+        Pair y = b ? loadPair(b + i) : kk;
+        storePair(out + i, op == Map::ADD ? addPair(x, y) : mulPair(x, y));
+    }
+    mapFrom<op>(a, b, k, out, i, n);
+}
+#endif
+
+// --- four lanes in plain doubles, where there is neither (wasm) ---
+
+#ifndef RIZZ_PAIRS
+template <Reduce op>
+static double reduceLanes(const Value *a, size_t n) {
+    double acc[4] = {identity<op>(a), identity<op>(a), identity<op>(a), identity<op>(a)};
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+        for (int j = 0; j < 4; ++j) acc[j] = combine<op>(acc[j], a[i + j].asNumber());
+    return reduceFrom<op>(a, i, n, combineLanes<op>(acc[0], acc[1], acc[2], acc[3]));
+}
+
+static double dotLanes(const Value *a, const Value *b, size_t n) {
+    double acc[4] = {0.0, 0.0, 0.0, 0.0};
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+        for (int j = 0; j < 4; ++j) acc[j] += a[i + j].asNumber() * b[i + j].asNumber();
+    return dotFrom(a, b, i, n, combineLanes<Reduce::SUM>(acc[0], acc[1], acc[2], acc[3]));
+}
+#endif
+
+// --- four lanes: AVX2 ---
+
+#ifdef RIZZ_AVX2
+static bool haveAvx2() {
+    static const bool have = [] {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") != 0;
+    }();
+    return have;
+}
+
+template <Reduce op>
+RIZZ_TARGET_AVX2 static double reduceAvx2(const Value *a, size_t n) {
+    __m256d acc = _mm256_set1_pd(identity<op>(a));
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d x = _mm256_loadu_pd(reinterpret_cast<const double *>(a + i));
+        if (op == Reduce::SUM) acc = _mm256_add_pd(acc, x);
+        else if (op == Reduce::MIN) acc = _mm256_min_pd(x, acc);
+        else acc = _mm256_max_pd(x, acc);
+    }
+    double lanes[4];
+    _mm256_storeu_pd(lanes, acc);
+    return reduceFrom<op>(a, i, n, combineLanes<op>(lanes[0], lanes[1], lanes[2], lanes[3]));
+}
+
+RIZZ_TARGET_AVX2 static double dotAvx2(const Value *a, const Value *b, size_t n) {
+    __m256d acc = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d x = _mm256_loadu_pd(reinterpret_cast<const double *>(a + i));
+        __m256d y = _mm256_loadu_pd(reinterpret_cast<const double *>(b + i));
+        acc = _mm256_add_pd(acc, _mm256_mul_pd(x, y));
+    }
+    double lanes[4];
+    _mm256_storeu_pd(lanes, acc);
+    return dotFrom(a, b, i, n, combineLanes<Reduce::SUM>(lanes[0], lanes[1], lanes[2], lanes[3]));
+}
+
+template <Map op>
+RIZZ_TARGET_AVX2 static void mapAvx2(const Value *a, const Value *b, double k, Value *out, size_t n) {
+    __m256d kk = _mm256_set1_pd(k);
+    __m256d canonicalNan = _mm256_set1_pd(std::numeric_limits<double>::quiet_NaN());
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d x = _mm256_loadu_pd(reinterpret_cast<const double *>(a + i));
+        __m256d y = b ? _mm256_loadu_pd(reinterpret_cast<const double *>(b + i)) : kk;
+        __m256d r = op == Map::ADD ? _mm256_add_pd(x, y) : _mm256_mul_pd(x, y);
+        r = _mm256_blendv_pd(r, canonicalNan, _mm256_cmp_pd(r, r, _CMP_UNORD_Q));
+        _mm256_storeu_pd(reinterpret_cast<double *>(out + i), r);
+    }
+    mapFrom<op>(a, b, k, out, i, n);
+}
+#endif
+
+// --- picking the widest kernel there is ---
+
+template <Reduce op>
+static double reduce(const Value *a, size_t n) {
+#ifdef RIZZ_AVX2
+    if (haveAvx2()) return reduceAvx2<op>(a, n);
+#endif
+#ifdef RIZZ_PAIRS
+    return reducePairs<op>(a, n);
+#else
+    return reduceLanes<op>(a, n);
+#endif
+}
+
+static double dot(const Value *a, const Value *b, size_t n) {
+#ifdef RIZZ_AVX2
+    if (haveAvx2()) return dotAvx2(a, b, n);
+#endif
+#ifdef RIZZ_PAIRS
+    return dotPairs(a, b, n);
+#else
+    return dotLanes(a, b, n);
+#endif
+}
+
+template <Map op>
+static Value mapArray(const std::vector<Value> &a, const Value *b, double k) {
+    std::vector<Value> out(a.size());   // undefined until the kernel writes the numbers in
+#ifdef RIZZ_AVX2
+    if (haveAvx2()) {
+        mapAvx2<op>(a.data(), b, k, out.data(), a.size());
+        return makeArray(std::move(out));
+    }
+#endif
+#ifdef RIZZ_PAIRS
+    mapPairs<op>(a.data(), b, k, out.data(), a.size());
+#else
+    mapFrom<op>(a.data(), b, k, out.data(), 0, a.size());
+#endif
+    return makeArray(std::move(out));
+}
+
+// --- the builtins ---
+
+static void expectArgs(const char *name, size_t argc, size_t n) {
+    if (argc != n) throw std::runtime_error(std::string("Argument count mismatch in call to ") + name);
+}
+
+static const std::vector<Value> &numbersOf(const char *name, const Value &v) {
+    if (!v.isArray() || !v.asArray()->numeric())
+        throw std::runtime_error(std::string(name) + " needs an array of numbers");
+    return v.asArray()->items;
+}
+
+static Value builtinSum(const Value *args, size_t argc, DripCaller &) {
+    expectArgs("sum", argc, 1);
+    auto &a = numbersOf("sum", args[0]);
+    return reduce<Reduce::SUM>(a.data(), a.size());
+}
+
+static Value builtinMin(const Value *args, size_t argc, DripCaller &) {
+    expectArgs("min", argc, 1);
+    auto &a = numbersOf("min", args[0]);
+    if (a.empty()) throw std::runtime_error("min of an empty array");
+    return reduce<Reduce::MIN>(a.data(), a.size());
+}
+
+static Value builtinMax(const Value *args, size_t argc, DripCaller &) {
+    expectArgs("max", argc, 1);
+    auto &a = numbersOf("max", args[0]);
+    if (a.empty()) throw std::runtime_error("max of an empty array");
+    return reduce<Reduce::MAX>(a.data(), a.size());
+}
+
+static Value builtinDot(const Value *args, size_t argc, DripCaller &) {
+    expectArgs("dot", argc, 2);
+    auto &a = numbersOf("dot", args[0]);
+    auto &b = numbersOf("dot", args[1]);
+    if (a.size() != b.size()) throw std::runtime_error("dot needs two arrays of the same length");
+    return dot(a.data(), b.data(), a.size());
+}
+
+static Value builtinScale(const Value *args, size_t argc, DripCaller &) {
+    expectArgs("scale", argc, 2);
+    auto &a = numbersOf("scale", args[0]);
+    if (!args[1].isNumber()) throw std::runtime_error("scale needs a number to scale by");
+    return mapArray<Map::MUL>(a, nullptr, args[1].asNumber());
+}
+
+static Value builtinAdd(const Value *args, size_t argc, DripCaller &) {
+    expectArgs("add", argc, 2);
+    auto &a = numbersOf("add", args[0]);
+    if (args[1].isNumber()) return mapArray<Map::ADD>(a, nullptr, args[1].asNumber());
+    auto &b = numbersOf("add", args[1]);
+    if (a.size() != b.size()) throw std::runtime_error("add needs two arrays of the same length");
+    return mapArray<Map::ADD>(a, b.data(), 0.0);
+}
+
+static Value builtinLen(const Value *args, size_t argc, DripCaller &) {
+    expectArgs("len", argc, 1);
+    const Value &v = args[0];
+    if (v.isArray()) return (double)v.asArray()->items.size();
+    if (v.isString()) return (double)v.asStringObj()->length;
+    if (v.isDict()) return (double)v.asDict()->entries.size();
+    throw std::runtime_error("len needs an array, a string or a dict");
+}
+
+//a drip is no kernel, so map calls it once per item. scale and add are the vector versions of
+//the maps that need one.
+static Value builtinMap(const Value *args, size_t argc, DripCaller &caller) {
+    expectArgs("map", argc, 2);
+    if (!args[0].isArray()) throw std::runtime_error("map needs an array");
+    if (!args[1].isFunction()) throw std::runtime_error("map needs a drip to call");
+    Value array = args[0];  // keeps the items alive and unchanged while the drip runs
+    FuncDef *fn = args[1].asFunction()->fn;
+    std::vector<Value> out;
+    out.reserve(array.asArray()->items.size());
+    for (size_t i = 0; i < array.asArray()->items.size(); ++i) {
+        Value item = array.asArray()->items[i];
+        out.push_back(caller.call(fn, &item, 1));
+    }
+    return makeArray(std::move(out));
+}
+
+Builtin findBuiltin(Symbol name) {
+    static const SymbolMap<Builtin> builtins = [] {
+        SymbolMap<Builtin> table;
+        table[internSymbol("sum")] = builtinSum;
+        table[internSymbol("min")] = builtinMin;
+        table[internSymbol("max")] = builtinMax;
+        table[internSymbol("dot")] = builtinDot;
+        table[internSymbol("scale")] = builtinScale;
+        table[internSymbol("add")] = builtinAdd;
+        table[internSymbol("len")] = builtinLen;
+        table[internSymbol("map")] = builtinMap;
+        return table;
+    }();
+    return builtins.get(name);
+}
@@ -0,0 +1,31 @@
+// src/builtins.hpp
+//drips every script can call without defining them, shared by all engines. A drip or an object
+//of the same name defined by the script wins, a builtin is only looked at when nothing else matched.
+//
+//  sum(a) min(a) max(a)   reductions over an array of numbers
+//  dot(a, b)              sum of a[i] * b[i], both the same length
+//  scale(a, k)            new array of a[i] * k
+//  add(a, b)              new array of a[i] + b[i], b can also be a single number
+//  len(a)                 items of an array or dict, chars of a string
+//  map(a, f)              new array of f(a[i]), f is a drip passed by its name
+#pragma once
+#include "symbol.hpp"
+#include "value.hpp"
+#include <cstddef>
+
+//how a builtin calls a drip it was handed, every engine runs it its own way. The engine's stack may
+//move while fn runs, so a builtin copies out of its args what it still needs before calling, and
+//args given to call must not point into that stack either.
+class DripCaller {
+public:
+    virtual Value call(FuncDef *fn, const Value *args, size_t argc) = 0;
+
+protected:
+    ~DripCaller() = default;
+};
+
+//args are the argc values the call was made with
+using Builtin = Value (*)(const Value *args, size_t argc, DripCaller &caller);
+
+//nullptr when name is no builtin
+Builtin findBuiltin(Symbol name);
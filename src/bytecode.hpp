@@ -0,0 +1,97 @@
+// src/bytecode.hpp
+//bytecode produced by the Compiler and executed by the VM
+#pragma once
+#include "ast.hpp"
+#include "value.hpp"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//every operand is a 16 bit little endian number unless written otherwise
+enum OpCode : uint8_t {
+    OP_CONSTANT,        // k            push constants[k]
+    OP_CONSTANT_LONG,   // k(24 bit)    push constants[k], for chunks with more than 65536 constants
+    OP_POP,             //              drop top of stack
+    OP_GET_GLOBAL,      // name         push globals[name]
+    OP_SET_GLOBAL,      // name         globals[name] = pop
+    OP_GET_LOCAL,       // slot         push frame slot (falls back to the global of the same name when unset)
+    OP_SET_LOCAL,       // slot         frame slot = pop
+    OP_ADD, OP_SUB, OP_MUL, OP_DIV, OP_MOD,
+    OP_GT, OP_LT, OP_GE, OP_LE, OP_EQ, OP_NEQ,
+    OP_NOT, OP_NEGATE,
+    OP_JUMP,            // offset(32 bit)   ip += offset
+    OP_JUMP_IF_FALSE,   // offset(32 bit)   pop, jump when not truthy
+    OP_LOOP,            // offset(32 bit)   ip -= offset
+    OP_FOR_PREP,        // offset(32 bit)   counted loop, stack holds counter, limit, step: checks them and
+                        //                  pushes the counter, or jumps forward when there is nothing to do
+    OP_FOR_LOOP,        // offset(32 bit)   counter += step, while still in range push it and ip -= offset
+    OP_PRINT,           //              bruh pop
+    OP_INPUT,           // name         push the line typed for spill name
+    OP_INDEX,           //              push target[index]
+    OP_SET_INDEX,       //              target[index] = pop, pops index and target too
+    OP_SET_ELEMENT,     // place        place[index] = pop in place, pops index and the place's operands too
+    OP_ARRAY,           // count        pop count values into a new array
+    OP_DICT,            // count        pop count key, value pairs into a new dict
+    OP_CALL,            // name, argc(8 bit), local(8 bit), slot   the variable name resolves to is checked
+                        //              for an object to init when there is no drip called name
+    OP_INVOKE,          // name, argc(8 bit), cache   receiver sits below the arguments
+    OP_PLACE_INVOKE,    // place, name, argc(8 bit), cache   place.push(...) / place.pop(): changes an array
+                        //              in place, anything else gets the method called like OP_INVOKE
+    OP_GET_MEMBER,      // name, cache  obj.name
+    OP_SET_MEMBER,      // name, cache  obj.name = pop, pops obj too
+    OP_NEW,             // name         pullup name()
+    OP_DEFINE_FUNC,     // function     functions[its name] = program.functions[function]
+    OP_DEFINE_CLASS,    // name, class  classes[name] = program.classes[class]
+    OP_RETURN           //              return pop to the caller
+};
+
+struct Chunk {
+    std::vector<uint8_t> code;
+    std::vector<Value> constants;
+};
+
+struct Function;
+
+// A variable, a field or an item reached from one of those (see isPlace) that OP_SET_ELEMENT and
+// OP_PLACE_INVOKE change in place. What the way there depends on sits on the stack below the op's
+// own operands: the object for a FIELD root, then one value per index.
+struct Place {
+    enum Root : uint8_t { LOCAL, GLOBAL, FIELD } root;
+    int id;             // local slot, global name or field name
+    int cache = -1;     // FIELD: the site cache of the field
+    int depth = 0;      // indexes between the root and the place
+
+    int operands() const { return (root == FIELD) + depth; }
+};
+
+//inline cache of one member site, plus the compiled method it resolved to
+struct SiteCache {
+    InlineCache ic;
+    const Function *method = nullptr;
+};
+
+//compiled form of a FuncDef (or of the top level script)
+struct Function {
+    std::string name;
+    int nameId = -1;
+    FuncDef *def = nullptr;             // the drip it was compiled from, nullptr for the script
+    int arity = 0;
+    int selfSlot = -1;                  // slot holding self for methods, -1 otherwise
+    std::vector<int> localNames;        // name id of every local slot, params first
+    int maxStack = 0;                   // deepest expression stack the body needs
+    Chunk chunk;
+    mutable std::vector<SiteCache> caches;  // one per obj.name site, filled while running
+    std::vector<Place> places;
+};
+
+//everything the Compiler hands to the VM
+struct Program {
+    std::vector<std::string> names;     // every identifier, indexed by name id
+    std::vector<Symbol> symbols;        // interned names, same index
+    std::vector<std::unique_ptr<Function>> functions;
+    std::vector<ClassDef *> classes;
+    std::unordered_map<const FuncDef *, Function *> compiled;
+    Function *script = nullptr;
+};
@@ -0,0 +1,465 @@
+// src/cache.cpp
+//header: magic, format, source hash, checksum of the body. the body is the AST written
+//depth first, every node as its type byte followed by its fields.
+//numbers are little endian whatever the host is, so a cache file can move between machines
+#include "cache.hpp"
+#include "source.hpp"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+
+const char MAGIC[4] = {'R', 'Z', 'Z', 'C'};
+//bump whenever a node gains, loses or reorders a field
+const uint32_t FORMAT = 4;
+const uint8_t NO_NODE = 0xFF;
+const uint64_t FNV_OFFSET = 14695981039346656037ull;
+
+class Writer {
+public:
+    std::string out;
+
+    void u8(uint8_t v) { out.push_back((char)v); }
+    void u32(uint32_t v) {
+        for (int i = 0; i < 4; ++i) u8((uint8_t)(v >> (8 * i)));
+    }
+    void u64(uint64_t v) {
+        for (int i = 0; i < 8; ++i) u8((uint8_t)(v >> (8 * i)));
+    }
+    void number(double d) {
+        uint64_t bits;
+        std::memcpy(&bits, &d, sizeof d);
+        u64(bits);
+    }
+    void str(const std::string &s) {
+        u32((uint32_t)s.size());
+        out.append(s);
+    }
+
+    void list(NodeList<> nodes) {
+        u32(nodes.count);
+        for (auto n : nodes) node(n);
+    }
+
+    void node(const ASTNode *n) {
+        if (!n) {
+            u8(NO_NODE);
+            return;
+        }
+        u8((uint8_t)n->type);
+        switch (n->type) {
+        case ASTNodeType::PRINT_STMT:
+            node(static_cast<const PrintStmt *>(n)->value);
+            break;
+        case ASTNodeType::IF_STMT: {
+            auto s = static_cast<const IfStmt *>(n);
+            node(s->condition);
+            list(s->thenBranch);
+            node(s->next);
+            break;
+        }
+        case ASTNodeType::ASSIGN_STMT: {
+            auto s = static_cast<const AssignStmt *>(n);
+            str(s->name);
+            node(s->value);
+            break;
+        }
+        case ASTNodeType::EXPR_STMT:
+            node(static_cast<const ExprStmt *>(n)->expr);
+            break;
+        case ASTNodeType::INPUT_STMT:
+            str(static_cast<const InputStmt *>(n)->varName);
+            break;
+        case ASTNodeType::IDENT:
+            str(static_cast<const IdentExpr *>(n)->name);
+            break;
+        case ASTNodeType::NUMBER:
+            number(static_cast<const NumberExpr *>(n)->value);
+            break;
+        case ASTNodeType::STRING:
+            str(static_cast<const StringExpr *>(n)->value.asString());
+            break;
+        case ASTNodeType::BOOL:
+            u8(static_cast<const BoolExpr *>(n)->value ? 1 : 0);
+            break;
+        case ASTNodeType::BINARY_EXPR: {
+            auto e = static_cast<const BinaryExpr *>(n);
+            node(e->left);
+            str(e->op);
+            node(e->right);
+            break;
+        }
+        case ASTNodeType::UNARY_EXPR: {
+            auto e = static_cast<const UnaryExpr *>(n);
+            str(e->op);
+            node(e->operand);
+            break;
+        }
+        case ASTNodeType::INDEX_EXPR: {
+            auto e = static_cast<const IndexExpr *>(n);
+            node(e->target);
+            node(e->index);
+            break;
+        }
+        case ASTNodeType::INDEX_ASSIGN_STMT: {
+            auto s = static_cast<const IndexAssignStmt *>(n);
+            node(s->target);
+            node(s->index);
+            node(s->value);
+            break;
+        }
+        case ASTNodeType::DICT_LITERAL: {
+            auto d = static_cast<const DictLiteral *>(n);
+            list(d->keys);
+            list(d->values);
+            break;
+        }
+        case ASTNodeType::FUNC_DEF: {
+            auto f = static_cast<const FuncDef *>(n);
+            str(f->name);
+            u32((uint32_t)f->params.size());
+            for (auto &p : f->params) str(p);
+            // a body nobody called yet stays a source range, the cache only ever serves the same source
+            u8(f->deferred ? 1 : 0);
+            if (f->deferred) {
+                u64(f->bodyStart);
+                u64(f->bodyEnd);
+            } else {
+                list(f->body);
+            }
+            break;
+        }
+        case ASTNodeType::CLASS_DEF: {
+            auto c = static_cast<const ClassDef *>(n);
+            str(c->name);
+            u32(c->methods.count);
+            for (auto m : c->methods) node(m);
+            break;
+        }
+        case ASTNodeType::RETURN_STMT:
+            node(static_cast<const ReturnStmt *>(n)->value);
+            break;
+        case ASTNodeType::CALL_EXPR: {
+            auto e = static_cast<const CallExpr *>(n);
+            str(e->callee);
+            list(e->args);
+            break;
+        }
+        case ASTNodeType::NEW_OBJECT_EXPR: {
+            auto e = static_cast<const NewObjectExpr *>(n);
+            str(e->className);
+            list(e->args);
+            break;
+        }
+        case ASTNodeType::METHOD_CALL_EXPR: {
+            auto e = static_cast<const MethodCallExpr *>(n);
+            node(e->object);
+            str(e->method);
+            list(e->arguments);
+            break;
+        }
+        case ASTNodeType::ARRAY_LITERAL:
+            list(static_cast<const ArrayLiteral *>(n)->elements);
+            break;
+        case ASTNodeType::MEMBER_ACCESS_EXPR: {
+            auto e = static_cast<const MemberAccessExpr *>(n);
+            node(e->object);
+            str(e->member);
+            break;
+        }
+        case ASTNodeType::MEMBER_ASSIGN_STMT: {
+            auto s = static_cast<const MemberAssignStmt *>(n);
+            node(s->object);
+            str(s->member);
+            node(s->value);
+            break;
+        }
+        case ASTNodeType::LOOP_STMT: {
+            auto s = static_cast<const LoopStmt *>(n);
+            node(s->condition);
+            list(s->body);
+            break;
+        }
+        case ASTNodeType::COUNTED_LOOP_STMT: {
+            auto s = static_cast<const CountedLoopStmt *>(n);
+            str(s->varName);
+            node(s->from);
+            node(s->to);
+            node(s->step);
+            list(s->body);
+            break;
+        }
+        case ASTNodeType::BREAK_STMT:
+        case ASTNodeType::CONTINUE_STMT:
+            break;
+        }
+    }
+};
+
+//every read is bounds checked, a truncated or garbled file throws and is treated as a miss
+class Reader {
+public:
+    Reader(std::string_view data, std::string_view source, AstArena &a)
+        : p(data.data()), end(data.data() + data.size()), arena(a), deferred{source, &a} {}
+
+    uint8_t u8() {
+        need(1);
+        return (uint8_t)*p++;
+    }
+    uint32_t u32() {
+        uint32_t v = 0;
+        for (int i = 0; i < 4; ++i) v |= (uint32_t)u8() << (8 * i);
+        return v;
+    }
+    uint64_t u64() {
+        uint64_t v = 0;
+        for (int i = 0; i < 8; ++i) v |= (uint64_t)u8() << (8 * i);
+        return v;
+    }
+    double number() {
+        uint64_t bits = u64();
+        double d;
+        std::memcpy(&d, &bits, sizeof d);
+        return d;
+    }
+    std::string str() {
+        uint32_t n = u32();
+        need(n);
+        std::string s(p, n);
+        p += n;
+        return s;
+    }
+    bool atEnd() const { return p == end; }
+    std::string_view rest() const { return std::string_view(p, (size_t)(end - p)); }
+
+    NodeList<> list() {
+        uint32_t n = u32();
+        need(n); // every node takes at least a byte, stops absurd counts before allocating
+        std::vector<ASTNode *> nodes;
+        nodes.reserve(n);
+        for (uint32_t i = 0; i < n; ++i) nodes.push_back(node());
+        return makeList(arena, nodes);
+    }
+
+    template <class T>
+    T *nodeOf(ASTNodeType expected) {
+        ASTNode *n = node();
+        if (n && n->type != expected) throw std::runtime_error("unexpected node");
+        return static_cast<T *>(n);
+    }
+
+    ASTNode *node() {
+        uint8_t tag = u8();
+        if (tag == NO_NODE) return nullptr;
+        switch ((ASTNodeType)tag) {
+        case ASTNodeType::PRINT_STMT:
+            return arena.make<PrintStmt>(node());
+        case ASTNodeType::IF_STMT: {
+            ASTNode *cond = node();
+            NodeList<> body = list();
+            IfStmt *next = nodeOf<IfStmt>(ASTNodeType::IF_STMT);
+            return arena.make<IfStmt>(cond, body, next);
+        }
+        case ASTNodeType::ASSIGN_STMT: {
+            std::string name = str();
+            return arena.make<AssignStmt>(name, node());
+        }
+        case ASTNodeType::EXPR_STMT:
+            return arena.make<ExprStmt>(node());
+        case ASTNodeType::INPUT_STMT:
+            return arena.make<InputStmt>(str());
+        case ASTNodeType::IDENT:
+            return arena.make<IdentExpr>(str());
+        case ASTNodeType::NUMBER:
+            return arena.make<NumberExpr>(number());
+        case ASTNodeType::STRING:
+            return arena.make<StringExpr>(str());
+        case ASTNodeType::BOOL:
+            return arena.make<BoolExpr>(u8() != 0);
+        case ASTNodeType::BINARY_EXPR: {
+            ASTNode *left = node();
+            std::string op = str();
+            return arena.make<BinaryExpr>(left, op, node());
+        }
+        case ASTNodeType::UNARY_EXPR: {
+            std::string op = str();
+            return arena.make<UnaryExpr>(op, node());
+        }
+        case ASTNodeType::INDEX_EXPR: {
+            ASTNode *target = node();
+            return arena.make<IndexExpr>(target, node());
+        }
+        case ASTNodeType::INDEX_ASSIGN_STMT: {
+            ASTNode *target = node();
+            ASTNode *index = node();
+            return arena.make<IndexAssignStmt>(target, index, node());
+        }
+        case ASTNodeType::DICT_LITERAL: {
+            NodeList<> keys = list();
+            NodeList<> values = list();
+            if (keys.size() != values.size()) throw std::runtime_error("dict keys and values differ");
+            return arena.make<DictLiteral>(keys, values);
+        }
+        case ASTNodeType::FUNC_DEF:
+            return funcDef();
+        case ASTNodeType::CLASS_DEF: {
+            std::string name = str();
+            uint32_t n = u32();
+            need(n);
+            std::vector<FuncDef *> methods;
+            for (uint32_t i = 0; i < n; ++i) {
+                FuncDef *m = nodeOf<FuncDef>(ASTNodeType::FUNC_DEF);
+                if (!m) throw std::runtime_error("missing method");
+                methods.push_back(m);
+            }
+            return arena.make<ClassDef>(name, makeList(arena, methods));
+        }
+        case ASTNodeType::RETURN_STMT:
+            return arena.make<ReturnStmt>(node());
+        case ASTNodeType::CALL_EXPR: {
+            std::string callee = str();
+            return arena.make<CallExpr>(callee, list());
+        }
+        case ASTNodeType::NEW_OBJECT_EXPR: {
+            std::string className = str();
+            return arena.make<NewObjectExpr>(className, list());
+        }
+        case ASTNodeType::METHOD_CALL_EXPR: {
+            ASTNode *object = node();
+            std::string method = str();
+            return arena.make<MethodCallExpr>(object, method, list());
+        }
+        case ASTNodeType::ARRAY_LITERAL:
+            return arena.make<ArrayLiteral>(list());
+        case ASTNodeType::MEMBER_ACCESS_EXPR: {
+            ASTNode *object = node();
+            return arena.make<MemberAccessExpr>(object, str());
+        }
+        case ASTNodeType::MEMBER_ASSIGN_STMT: {
+            ASTNode *object = node();
+            std::string member = str();
+            return arena.make<MemberAssignStmt>(object, member, node());
+        }
+        case ASTNodeType::LOOP_STMT: {
+            ASTNode *cond = node();
+            return arena.make<LoopStmt>(cond, list());
+        }
+        case ASTNodeType::COUNTED_LOOP_STMT: {
+            std::string var = str();
+            ASTNode *from = node();
+            ASTNode *to = node();
+            ASTNode *step = node();
+            return arena.make<CountedLoopStmt>(var, from, to, step, list());
+        }
+        case ASTNodeType::BREAK_STMT:
+            return arena.make<BreakStmt>();
+        case ASTNodeType::CONTINUE_STMT:
+            return arena.make<ContinueStmt>();
+        }
+        throw std::runtime_error("unknown node type");
+    }
+
+private:
+    const char *p;
+    const char *end;
+    AstArena &arena;
+    DeferredSource deferred;
+    const DeferredSource *deferredSource = nullptr;   // copy of deferred in the arena, made once needed
+
+    void need(size_t n) {
+        if ((size_t)(end - p) < n) throw std::runtime_error("truncated cache file");
+    }
+
+    FuncDef *funcDef() {
+        std::string name = str();
+        uint32_t n = u32();
+        need(n);
+        std::vector<std::string> params;
+        for (uint32_t i = 0; i < n; ++i) params.push_back(str());
+        if (!u8()) return arena.make<FuncDef>(name, params, list());
+
+        auto fn = arena.make<FuncDef>(name, params, NodeList<>());
+        fn->bodyStart = (size_t)u64();
+        fn->bodyEnd = (size_t)u64();
+        if (fn->bodyStart > fn->bodyEnd || fn->bodyEnd > deferred.text.size())
+            throw std::runtime_error("body outside of the source");
+        if (!deferredSource) deferredSource = arena.make<DeferredSource>(deferred);
+        fn->deferred = deferredSource;
+        return fn;
+    }
+};
+
+}
+
+static uint64_t fnv1a(uint64_t h, std::string_view bytes) {
+    for (unsigned char c : bytes) {
+        h ^= c;
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+uint64_t sourceHash(std::string_view code) {
+    uint64_t h = fnv1a(FNV_OFFSET, RIZZ_VERSION);
+    h = fnv1a(h, std::string_view("\0", 1));
+    return fnv1a(h, code);
+}
+
+std::string cachePathFor(const std::string &scriptPath) {
+    return scriptPath + "c";
+}
+
+CacheResult loadCachedScript(const std::string &path, std::string_view source, uint64_t hash, Script &out) {
+    SourceFile file;   // mapped like the scripts themselves
+    if (!file.open(path)) return CacheResult::Missing;
+
+    Script script;
+    try {
+        Reader in(file.text(), source, *script.arena);
+        char magic[4];
+        for (char &c : magic) c = (char)in.u8();
+        if (std::memcmp(magic, MAGIC, 4) != 0) return CacheResult::Corrupt;
+        if (in.u32() != FORMAT || in.u64() != hash) return CacheResult::Stale;
+        // a damaged body could still decode into some other valid program, so it is checksummed too
+        uint64_t checksum = in.u64();
+        if (fnv1a(FNV_OFFSET, in.rest()) != checksum) return CacheResult::Corrupt;
+        script.statements = in.list();
+        if (!in.atEnd()) return CacheResult::Corrupt;
+    } catch (const std::exception &) {
+        return CacheResult::Corrupt;
+    }
+    out = std::move(script);
+    return CacheResult::Hit;
+}
+
+bool saveCachedScript(const std::string &path, uint64_t hash, const Script &script) {
+    Writer body;
+    body.list(script.statements);
+    Writer w;
+    for (char c : MAGIC) w.u8((uint8_t)c);
+    w.u32(FORMAT);
+    w.u64(hash);
+    w.u64(fnv1a(FNV_OFFSET, body.out));
+    w.out += body.out;
+
+    // written aside and renamed, a run reading the cache never sees half a file
+    std::string tmp = path + ".tmp";
+    {
+        std::ofstream file(tmp, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) return false;
+        file.write(w.out.data(), (std::streamsize)w.out.size());
+        if (!file) {
+            file.close();
+            std::remove(tmp.c_str());
+            return false;
+        }
+    }
+    std::remove(path.c_str()); // rename does not replace an existing file on windows
+    if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+        std::remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
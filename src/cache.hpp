@@ -0,0 +1,25 @@
+// src/cache.hpp
+//.rizzc files: the parsed program saved next to its script, so the next run of the same script
+//skips the lexer and parser. A cache file is only used when it was made from the exact same
+//source by the same rizz version, anything else is a miss and gets overwritten.
+#pragma once
+#include "ast.hpp"
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#define RIZZ_VERSION "1.0.12"
+
+enum class CacheResult { Hit, Missing, Stale, Corrupt };
+
+//key of a script: FNV-1a over the rizz version and the source text
+uint64_t sourceHash(std::string_view code);
+
+//foo.rizz -> foo.rizzc
+std::string cachePathFor(const std::string &scriptPath);
+
+//source is the script the hash was taken from, drips not parsed yet read their bodies from it
+CacheResult loadCachedScript(const std::string &path, std::string_view source, uint64_t hash, Script &out);
+
+//false when the cache file could not be written (read-only directory...), the run goes on anyway
+bool saveCachedScript(const std::string &path, uint64_t hash, const Script &script);
@@ -0,0 +1,495 @@
+// src/closure.cpp
+//runs exactly like the Interpreter (same frames, same Resolver slots, same errors), only the
+//decisions it makes per node on every evaluation are made here once, while compiling
+#include "closure.hpp"
+#include "dict.hpp"
+#include <cmath>
+#include <functional>
+#include <stdexcept>
+
+void ClosureEngine::execute(NodeList<> statements) {
+    resolver.deferBodies = true;
+    resolver.resolve(statements);
+    frames.globals.assign(resolver.globalNames().size(), Value());
+
+    Stmt script = compileBlock(statements);
+    script(); // a return at top level just ends the script
+}
+
+ClosureEngine::Function *ClosureEngine::functionFor(FuncDef *def) {
+    auto &fn = compiled[def];
+    if (!fn) fn.reset(new Function{def, nullptr});
+    return fn.get();
+}
+
+//the arguments were pushed by the caller and become the first slots of the callee's frame
+Value ClosureEngine::callFunction(Function *fn, size_t base, const Value &self) {
+    FuncDef *def = fn->def;
+    frames.checkArguments(def, base);
+    if (!fn->body) {
+        // first call: parse and resolve the body if it is still deferred, then compile it
+        try {
+            if (def->deferred) {
+                resolver.resolveBody(*def);
+                frames.globals.resize(resolver.globalNames().size());
+            }
+            fn->body = compileBlock(def->body);
+        } catch (...) {
+            frames.stack.resize(base);
+            throw;
+        }
+    }
+
+    Frames::Caller caller = frames.enter(def, base, self);
+    Value result = 0.0;
+    if (fn->body() == ExecSignal::Return) result = std::move(returnValue);
+    frames.leave(caller, base);
+    return result;
+}
+
+//a drip called by a builtin like map
+Value ClosureEngine::call(FuncDef *fn, const Value *args, size_t argc) {
+    size_t base = frames.stack.size();
+    frames.stack.insert(frames.stack.end(), args, args + argc);
+    return callFunction(functionFor(fn), base, Value());
+}
+
+//evaluates call arguments straight onto the stack like Interpreter::pushArguments
+size_t ClosureEngine::pushArguments(const std::vector<Expr> &args) {
+    size_t base = frames.stack.size();
+    for (auto &a : args) {
+        Value v = a(); // may run other calls, which leave the stack as they found it
+        frames.stack.push_back(std::move(v));
+    }
+    return base;
+}
+
+ClosureEngine::Stmt ClosureEngine::compileBlock(NodeList<> statements) {
+    std::vector<Stmt> body;
+    for (auto stmt : statements)
+        if (stmt) body.push_back(compileStatement(stmt));
+    if (body.size() == 1) return std::move(body[0]);
+    return [body = std::move(body)]() {
+        for (auto &stmt : body) {
+            ExecSignal signal = stmt();
+            if (signal != ExecSignal::Normal) return signal;
+        }
+        return ExecSignal::Normal;
+    };
+}
+
+std::vector<ClosureEngine::Expr> ClosureEngine::compileList(NodeList<> nodes) {
+    std::vector<Expr> out;
+    out.reserve(nodes.size());
+    for (auto n : nodes) out.push_back(compileExpression(n));
+    return out;
+}
+
+ClosureEngine::Stmt ClosureEngine::assignTo(const VarRef &ref, Expr value) {
+    int slot = ref.slot;
+    if (ref.local) {
+        return [this, slot, value = std::move(value)]() {
+            Value v = value(); // evaluated first, a call in there may grow the stack
+            frames.stack[frames.base + slot] = std::move(v);
+            return ExecSignal::Normal;
+        };
+    }
+    return [this, slot, value = std::move(value)]() {
+        Value v = value();
+        frames.globals[slot] = std::move(v);
+        return ExecSignal::Normal;
+    };
+}
+
+ClosureEngine::Place ClosureEngine::compilePlace(ASTNode *node) {
+    if (node->type == ASTNodeType::IDENT) {
+        auto e = static_cast<IdentExpr *>(node);
+        return {[](std::vector<Value> &) {},
+                [this, e](const Value *&) -> Value & { return frames.placeRoot(e); }};
+    }
+    if (node->type == ASTNodeType::MEMBER_ACCESS_EXPR) {
+        auto ma = static_cast<MemberAccessExpr *>(node);
+        Expr object = compileExpression(ma->object);
+        return {[object](std::vector<Value> &operands) { operands.push_back(object()); },
+                [ma](const Value *&operand) -> Value & { return fieldPlace(ma, *operand++); }};
+    }
+    auto ie = static_cast<IndexExpr *>(node);
+    Place target = compilePlace(ie->target);
+    Expr index = compileExpression(ie->index);
+    return {[target, index](std::vector<Value> &operands) {
+                target.operands(operands);
+                operands.push_back(index());
+            },
+            [target](const Value *&operand) -> Value & {
+                Value &container = target.slot(operand);
+                return *elementSlot(container, *operand++);
+            }};
+}
+
+ClosureEngine::Stmt ClosureEngine::compileStatement(ASTNode *node) {
+    switch (node->type) {
+    case ASTNodeType::PRINT_STMT: {
+        Expr value = compileExpression(static_cast<PrintStmt *>(node)->value);
+        return [this, value]() {
+            printValue(out, value());
+            return ExecSignal::Normal;
+        };
+    }
+
+    case ASTNodeType::ASSIGN_STMT: {
+        auto stmt = static_cast<AssignStmt *>(node);
+        return assignTo(stmt->ref, compileExpression(stmt->value));
+    }
+
+    case ASTNodeType::INPUT_STMT: {
+        auto stmt = static_cast<InputStmt *>(node);
+        const std::string *name = &stmt->varName;
+        return assignTo(stmt->ref, [this, name]() { return readInput(out, *name); });
+    }
+
+    case ASTNodeType::EXPR_STMT: {
+        Expr expr = compileExpression(static_cast<ExprStmt *>(node)->expr);
+        return [expr]() {
+            expr();
+            return ExecSignal::Normal;
+        };
+    }
+
+    case ASTNodeType::MEMBER_ASSIGN_STMT: {
+        auto stmt = static_cast<MemberAssignStmt *>(node);
+        Expr object = compileExpression(stmt->object);
+        Expr value = compileExpression(stmt->value);
+        return [stmt, object, value]() {
+            Value obj = object();
+            setMember(stmt->cache, instanceOf(obj, "set member"), stmt->memberSymbol, value());
+            return ExecSignal::Normal;
+        };
+    }
+
+    case ASTNodeType::INDEX_ASSIGN_STMT: {
+        auto stmt = static_cast<IndexAssignStmt *>(node);
+        Expr index = compileExpression(stmt->index);
+        Expr value = compileExpression(stmt->value);
+        if (!isPlace(stmt->target)) {
+            Expr target = compileExpression(stmt->target);
+            return [target, index, value]() {
+                Value t = target();
+                Value i = index();
+                assignIndex(t, i, value());
+                return ExecSignal::Normal;
+            };
+        }
+        Place target = compilePlace(stmt->target);
+        return [target, index, value]() {
+            std::vector<Value> operands;
+            target.operands(operands);
+            Value i = index();
+            Value v = value();
+            const Value *operand = operands.data();
+            assignIndex(target.slot(operand), i, std::move(v));
+            return ExecSignal::Normal;
+        };
+    }
+
+    case ASTNodeType::IF_STMT: {
+        struct Branch {
+            Expr condition;   // empty for forReal
+            Stmt body;
+        };
+        std::vector<Branch> branches;
+        for (auto b = static_cast<IfStmt *>(node); b; b = b->next)
+            branches.push_back({b->condition ? compileExpression(b->condition) : Expr(), compileBlock(b->thenBranch)});
+        return [branches = std::move(branches)]() {
+            for (auto &b : branches)
+                if (!b.condition || isTruthy(b.condition())) return b.body();
+            return ExecSignal::Normal;
+        };
+    }
+
+    case ASTNodeType::LOOP_STMT: {
+        auto loop = static_cast<LoopStmt *>(node);
+        Expr condition = compileExpression(loop->condition);
+        Stmt body = compileBlock(loop->body);
+        return [condition, body]() {
+            while (isTruthy(condition())) {
+                ExecSignal signal = body();
+                if (signal == ExecSignal::Break) break;
+                if (signal == ExecSignal::Return) return signal;
+            }
+            return ExecSignal::Normal;
+        };
+    }
+
+    case ASTNodeType::COUNTED_LOOP_STMT: {
+        auto loop = static_cast<CountedLoopStmt *>(node);
+        Expr from = compileExpression(loop->from);
+        Expr to = compileExpression(loop->to);
+        Expr step = loop->step ? compileExpression(loop->step) : [] { return Value(1.0); };
+        Stmt body = compileBlock(loop->body);
+        VarRef ref = loop->ref;
+        return [this, from, to, step, body, ref]() {
+            Value first = from();
+            Value last = to();
+            Value by = step();
+            LoopRange range = loopRange(first, last, by);
+
+            for (double i = range.from; range.more(i); i += range.by) {
+                frames.slot(ref) = i;
+                ExecSignal signal = body();
+                if (signal == ExecSignal::Break) break;
+                if (signal == ExecSignal::Return) return signal;
+            }
+            return ExecSignal::Normal;
+        };
+    }
+
+    case ASTNodeType::BREAK_STMT:
+        return [] { return ExecSignal::Break; };
+
+    case ASTNodeType::CONTINUE_STMT:
+        return [] { return ExecSignal::Continue; };
+
+    case ASTNodeType::RETURN_STMT: {
+        auto stmt = static_cast<ReturnStmt *>(node);
+        if (!stmt->value) {
+            return [this]() {
+                returnValue = 0.0;
+                return ExecSignal::Return;
+            };
+        }
+        Expr value = compileExpression(stmt->value);
+        return [this, value]() {
+            returnValue = value();
+            return ExecSignal::Return;
+        };
+    }
+
+    case ASTNodeType::FUNC_DEF: {
+        auto def = static_cast<FuncDef *>(node);
+        Function *fn = functionFor(def);
+        Value drip(new FunctionObj(def));
+        return [this, fn, drip]() {
+            functions[fn->def->symbol] = fn;
+            frames.drips[fn->def->symbol] = drip;
+            return ExecSignal::Normal;
+        };
+    }
+
+    case ASTNodeType::CLASS_DEF: {
+        auto cl = static_cast<ClassDef *>(node);
+        return [this, cl]() {
+            classes[cl->symbol] = makeClass(*cl);
+            return ExecSignal::Normal;
+        };
+    }
+
+    default:
+        throw std::runtime_error("Unknown AST node type in closure compiler");
+    }
+}
+
+//one closure per operator, numbers take the operator directly and the rest goes to concatValues
+//like in every other engine; a number literal on the right is folded into the closure
+template <class Op>
+static std::function<Value()> binaryClosure(std::function<Value()> left, ASTNode *right,
+                                            std::function<Value()> rightExpr, const std::string *op, Op apply) {
+    if (right->type == ASTNodeType::NUMBER) {
+        double r = static_cast<NumberExpr *>(right)->value;
+        return [left, r, op, apply]() -> Value {
+            Value L = left();
+            if (L.isNumber()) return apply(L.asNumber(), r);
+            return concatValues(*op, L, Value(r));
+        };
+    }
+    return [left, rightExpr, op, apply]() -> Value {
+        Value L = left();
+        Value R = rightExpr();
+        if (L.isNumber() && R.isNumber()) return apply(L.asNumber(), R.asNumber());
+        return concatValues(*op, L, R);
+    };
+}
+
+ClosureEngine::Expr ClosureEngine::compileBinary(BinaryExpr *be) {
+    Expr left = compileExpression(be->left);
+    Expr right = compileExpression(be->right);
+    const std::string *op = &be->op;
+    switch (be->opcode) {
+    case BinaryOp::ADD: return binaryClosure(left, be->right, right, op, std::plus<double>());
+    case BinaryOp::SUB: return binaryClosure(left, be->right, right, op, std::minus<double>());
+    case BinaryOp::MUL: return binaryClosure(left, be->right, right, op, std::multiplies<double>());
+    case BinaryOp::DIV: return binaryClosure(left, be->right, right, op, std::divides<double>());
+    case BinaryOp::MOD:
+        return binaryClosure(left, be->right, right, op, [](double l, double r) { return std::fmod(l, r); });
+    case BinaryOp::GT: return binaryClosure(left, be->right, right, op, std::greater<double>());
+    case BinaryOp::LT: return binaryClosure(left, be->right, right, op, std::less<double>());
+    case BinaryOp::GE: return binaryClosure(left, be->right, right, op, std::greater_equal<double>());
+    case BinaryOp::LE: return binaryClosure(left, be->right, right, op, std::less_equal<double>());
+    case BinaryOp::EQ: return binaryClosure(left, be->right, right, op, std::equal_to<double>());
+    case BinaryOp::NEQ: return binaryClosure(left, be->right, right, op, std::not_equal_to<double>());
+    default:
+        return [left, right, op]() -> Value {
+            Value L = left();
+            Value R = right();
+            return concatValues(*op, L, R);
+        };
+    }
+}
+
+ClosureEngine::Expr ClosureEngine::compileExpression(ASTNode *node) {
+    switch (node->type) {
+    case ASTNodeType::NUMBER: {
+        Value v = static_cast<NumberExpr *>(node)->value;
+        return [v]() { return v; };
+    }
+
+    case ASTNodeType::STRING: {
+        Value v = static_cast<StringExpr *>(node)->value;
+        return [v]() { return v; };
+    }
+
+    case ASTNodeType::BOOL: {
+        Value v = static_cast<BoolExpr *>(node)->value;
+        return [v]() { return v; };
+    }
+
+    case ASTNodeType::IDENT: {
+        auto e = static_cast<IdentExpr *>(node);
+        return [this, e]() -> Value { return frames.read(e->ref, e->name); };
+    }
+
+    case ASTNodeType::BINARY_EXPR:
+        return compileBinary(static_cast<BinaryExpr *>(node));
+
+    case ASTNodeType::UNARY_EXPR: {
+        auto ue = static_cast<UnaryExpr *>(node);
+        Expr operand = compileExpression(ue->operand);
+        if (ue->op == "!") {
+            return [operand]() { return logicalNot(operand()); };
+        }
+        if (ue->op == "-") {
+            return [operand]() { return negate(operand()); };
+        }
+        const std::string *op = &ue->op;
+        return [operand, op]() -> Value {
+            operand();
+            throw std::runtime_error("Unknown unary operator: " + *op);
+        };
+    }
+
+    case ASTNodeType::INDEX_EXPR: {
+        auto ie = static_cast<IndexExpr *>(node);
+        Expr index = compileExpression(ie->index);
+        // the target is evaluated before the index. arr[i] on a variable reads the stored array in
+        // place instead of taking another reference to it, when the index can't change what that refers to
+        if (ie->target->type == ASTNodeType::IDENT && isSimpleOperand(ie->index)) {
+            auto e = static_cast<IdentExpr *>(ie->target);
+            return [this, e, index]() {
+                const Value &t = frames.read(e->ref, e->name);
+                return indexValue(t, index());
+            };
+        }
+        Expr target = compileExpression(ie->target);
+        return [index, target]() {
+            Value t = target();
+            Value i = index();
+            return indexValue(t, i);
+        };
+    }
+
+    case ASTNodeType::ARRAY_LITERAL: {
+        std::vector<Expr> elements = compileList(static_cast<ArrayLiteral *>(node)->elements);
+        return [elements]() {
+            std::vector<Value> vals;
+            vals.reserve(elements.size());
+            for (auto &el : elements) vals.push_back(el());
+            return makeArray(std::move(vals));
+        };
+    }
+
+    case ASTNodeType::DICT_LITERAL: {
+        auto dictNode = static_cast<DictLiteral *>(node);
+        std::vector<Expr> keys = compileList(dictNode->keys);
+        std::vector<Expr> values = compileList(dictNode->values);
+        return [keys, values]() {
+            Value dict = makeDict();
+            for (size_t i = 0; i < keys.size(); ++i) {
+                Value key = keys[i]();
+                dict.asDict()->set(key, values[i]());
+            }
+            return dict;
+        };
+    }
+
+    case ASTNodeType::CALL_EXPR: {
+        auto call = static_cast<CallExpr *>(node);
+        std::vector<Expr> args = compileList(call->args);
+        return [this, call, args]() -> Value {
+            if (Function *fn = functions.get(call->calleeSymbol))
+                return callFunction(fn, pushArguments(args), Value());
+            Value callee = frames.slot(call->calleeVar);
+            Builtin builtin = nullptr;
+            if (FuncDef *init = constructorOrBuiltin(call, callee, builtin))
+                return callFunction(functionFor(init), pushArguments(args), callee);
+            size_t base = pushArguments(args);
+            Value result = builtin(frames.stack.data() + base, frames.stack.size() - base, *this);
+            frames.stack.resize(base);
+            return result;
+        };
+    }
+
+    case ASTNodeType::NEW_OBJECT_EXPR: {
+        auto no = static_cast<NewObjectExpr *>(node);
+        return [this, no]() { return newObject(classes, no); };
+    }
+
+    case ASTNodeType::METHOD_CALL_EXPR: {
+        auto mc = static_cast<MethodCallExpr *>(node);
+        std::vector<Expr> args = compileList(mc->arguments);
+        if (isArrayMethod(mc->methodSymbol) && isPlace(mc->object)) {
+            // a.push(v) changes the array where it is stored, an object's own push is still called
+            Place place = compilePlace(mc->object);
+            return [this, mc, place, args]() {
+                std::vector<Value> operands;
+                place.operands(operands);
+                const Value *operand = operands.data();
+                Value obj = place.slot(operand);
+                if (obj.isArray()) {
+                    obj = Value(); // don't hold on to it, that would make push copy
+                    size_t base = pushArguments(args);
+                    operand = operands.data();
+                    Value result = callArrayMethod(place.slot(operand), mc->methodSymbol,
+                                                   frames.stack.data() + base, frames.stack.size() - base);
+                    frames.stack.resize(base);
+                    return result;
+                }
+                Function *fn = functionFor(methodFor(mc, obj));
+                return callFunction(fn, pushArguments(args), obj);
+            };
+        }
+        Expr object = compileExpression(mc->object);
+        return [this, mc, object, args]() {
+            Value obj = object();
+            if (obj.isArray() && isArrayMethod(mc->methodSymbol)) {
+                size_t base = pushArguments(args);
+                Value result = callArrayMethod(obj, mc->methodSymbol, frames.stack.data() + base, frames.stack.size() - base);
+                frames.stack.resize(base);
+                return result;
+            }
+            Function *fn = functionFor(methodFor(mc, obj));
+            return callFunction(fn, pushArguments(args), obj);
+        };
+    }
+
+    case ASTNodeType::MEMBER_ACCESS_EXPR: {
+        auto ma = static_cast<MemberAccessExpr *>(node);
+        Expr object = compileExpression(ma->object);
+        return [ma, object]() {
+            Value obj = object();
+            return getMember(ma->cache, instanceOf(obj, "access member"), ma->memberSymbol);
+        };
+    }
+
+    default:
+        throw std::runtime_error("Unknown expression node in closure compiler");
+    }
+}
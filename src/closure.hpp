@@ -0,0 +1,59 @@
+// src/closure.hpp
+//third engine, between the tree-walker and the vm: every node is compiled once into a closure that
+//already knows its operator, its variable slots and the closures of its children, so running a node
+//is one indirect call with no switch on the node type and no string compare
+#pragma once
+#include "ast.hpp"
+#include "interpreter.hpp"
+#include "output.hpp"
+#include "resolver.hpp"
+#include "value.hpp"
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class ClosureEngine : DripCaller {
+public:
+    explicit ClosureEngine(Output &out) : out(out) {}
+    void execute(NodeList<> statements);
+
+private:
+    using Expr = std::function<Value()>;
+    using Stmt = std::function<ExecSignal()>;
+
+    // a place (see isPlace) in two steps like Interpreter::placeOperands/placeSlot: operands
+    // evaluates what the way there depends on, slot walks there with those evaluating nothing
+    struct Place {
+        std::function<void(std::vector<Value> &)> operands;
+        std::function<Value &(const Value *&)> slot;
+    };
+
+    // a drip and its compiled body, the body is compiled on the first call
+    struct Function {
+        FuncDef *def;
+        Stmt body;
+    };
+
+    Output &out;
+    Resolver resolver;
+    Frames frames;
+    std::unordered_map<FuncDef *, std::unique_ptr<Function>> compiled;
+    SymbolMap<Function *> functions;            // drips defined so far, by name
+    SymbolMap<Value> classes;
+    Value returnValue;
+
+    Function *functionFor(FuncDef *def);
+    Value callFunction(Function *fn, size_t base, const Value &self);
+    Value call(FuncDef *fn, const Value *args, size_t argc) override;
+    size_t pushArguments(const std::vector<Expr> &args);
+
+    Stmt compileBlock(NodeList<> statements);
+    Stmt compileStatement(ASTNode *node);
+    Expr compileExpression(ASTNode *node);
+    Expr compileBinary(BinaryExpr *be);
+    std::vector<Expr> compileList(NodeList<> nodes);
+    Stmt assignTo(const VarRef &ref, Expr value);
+    Place compilePlace(ASTNode *node);
+};
@@ -0,0 +1,472 @@
+// src/compiler.cpp
+//walks the AST once and turns it into bytecode, variable slots come from the Resolver so the vm never hashes a name
+#include "compiler.hpp"
+#include "resolver.hpp"
+#include <stdexcept>
+
+Program Compiler::compile(NodeList<> statements) {
+    // the resolver's global slots become the first name ids so GET_GLOBAL can use them as is
+    Resolver resolver;
+    resolver.resolve(statements);
+    for (auto &name : resolver.globalNames()) nameId(name);
+
+    auto script = std::make_unique<Function>();
+    script->name = "<script>";
+    current = script.get();
+    program.script = script.get();
+    program.functions.push_back(std::move(script));
+
+    for (auto &stmt : statements) statement(stmt);
+    emitConstant(0.0);
+    emitOp(OP_RETURN, -1);
+
+    return std::move(program);
+}
+
+int Compiler::nameId(const std::string &name) {
+    auto it = nameIds.find(name);
+    if (it != nameIds.end()) return it->second;
+    int id = (int)program.names.size();
+    program.names.push_back(name);
+    program.symbols.push_back(internSymbol(name));
+    nameIds[name] = id;
+    return id;
+}
+
+//returns the index of the new function in program.functions
+int Compiler::compileFunction(FuncDef *fn, bool isMethod) {
+    auto compiled = std::make_unique<Function>();
+    compiled->name = fn->name;
+    compiled->def = fn;
+    compiled->nameId = nameId(fn->name);
+    compiled->arity = (int)fn->params.size();
+    Function *result = compiled.get();
+    int index = (int)program.functions.size();
+    program.functions.push_back(std::move(compiled));
+    program.compiled[fn] = result;
+
+    result->localNames = fn->localGlobals;
+    result->selfSlot = isMethod ? fn->selfSlot : -1;
+
+    Function *enclosing = current;
+    int enclosingDepth = depth;
+    auto enclosingConstants = std::move(constantIds);
+    current = result;
+    depth = 0;
+    constantIds.clear();
+
+    for (auto &stmt : fn->body) statement(stmt);
+    emitConstant(0.0);
+    emitOp(OP_RETURN, -1);
+
+    current = enclosing;
+    depth = enclosingDepth;
+    constantIds = std::move(enclosingConstants);
+    return index;
+}
+
+void Compiler::loadVariable(const VarRef &ref) {
+    emitOp(ref.local ? OP_GET_LOCAL : OP_GET_GLOBAL, 1);
+    emit16(ref.slot);
+}
+
+void Compiler::storeVariable(const VarRef &ref) {
+    emitOp(ref.local ? OP_SET_LOCAL : OP_SET_GLOBAL, -1);
+    emit16(ref.slot);
+}
+
+//pushes the operands of a place and returns its index in current->places
+int Compiler::place(ASTNode *node) {
+    std::vector<ASTNode *> indexes;
+    while (node->type == ASTNodeType::INDEX_EXPR) {
+        auto ie = static_cast<IndexExpr *>(node);
+        indexes.push_back(ie->index);
+        node = ie->target;
+    }
+    Place p;
+    if (node->type == ASTNodeType::IDENT) {
+        const VarRef &ref = static_cast<IdentExpr *>(node)->ref;
+        p.root = ref.local ? Place::LOCAL : Place::GLOBAL;
+        p.id = ref.slot;
+    } else {
+        auto ma = static_cast<MemberAccessExpr *>(node);
+        expression(ma->object);
+        p.root = Place::FIELD;
+        p.id = nameId(ma->member);
+        p.cache = addCache();
+    }
+    for (auto it = indexes.rbegin(); it != indexes.rend(); ++it) expression(*it);
+    p.depth = (int)indexes.size();
+    current->places.push_back(p);
+    if (current->places.size() > 0x10000) throw std::runtime_error("Too many places in one function");
+    return (int)current->places.size() - 1;
+}
+
+void Compiler::statement(ASTNode *node) {
+    if (!node) return;
+    switch (node->type) {
+    case ASTNodeType::PRINT_STMT:
+        expression(static_cast<PrintStmt *>(node)->value);
+        emitOp(OP_PRINT, -1);
+        break;
+
+    case ASTNodeType::ASSIGN_STMT: {
+        auto stmt = static_cast<AssignStmt *>(node);
+        expression(stmt->value);
+        storeVariable(stmt->ref);
+        break;
+    }
+
+    case ASTNodeType::INPUT_STMT: {
+        auto stmt = static_cast<InputStmt *>(node);
+        emitOp(OP_INPUT, 1);
+        emit16(nameId(stmt->varName));
+        storeVariable(stmt->ref);
+        break;
+    }
+
+    case ASTNodeType::EXPR_STMT:
+        expression(static_cast<ExprStmt *>(node)->expr);
+        emitOp(OP_POP, -1);
+        break;
+
+    case ASTNodeType::MEMBER_ASSIGN_STMT: {
+        auto stmt = static_cast<MemberAssignStmt *>(node);
+        expression(stmt->object);
+        expression(stmt->value);
+        emitOp(OP_SET_MEMBER, -2);
+        emit16(nameId(stmt->member));
+        emit16(addCache());
+        break;
+    }
+
+    case ASTNodeType::INDEX_ASSIGN_STMT: {
+        auto stmt = static_cast<IndexAssignStmt *>(node);
+        if (!isPlace(stmt->target)) {
+            expression(stmt->target);
+            expression(stmt->index);
+            expression(stmt->value);
+            emitOp(OP_SET_INDEX, -3);
+            break;
+        }
+        int p = place(stmt->target);
+        expression(stmt->index);
+        expression(stmt->value);
+        emitOp(OP_SET_ELEMENT, -2 - current->places[p].operands());
+        emit16(p);
+        break;
+    }
+
+    case ASTNodeType::IF_STMT: {
+        std::vector<int> exits;
+        for (auto branch = static_cast<IfStmt *>(node); branch; branch = branch->next) {
+            if (!branch->condition) {
+                for (auto &s : branch->thenBranch) statement(s);
+                break;
+            }
+            expression(branch->condition);
+            int skip = emitJump(OP_JUMP_IF_FALSE);
+            for (auto &s : branch->thenBranch) statement(s);
+            if (branch->next) exits.push_back(emitJump(OP_JUMP));
+            patchJump(skip);
+        }
+        for (int at : exits) patchJump(at);
+        break;
+    }
+
+    case ASTNodeType::LOOP_STMT: {
+        auto loop = static_cast<LoopStmt *>(node);
+        int start = (int)current->chunk.code.size();
+        expression(loop->condition);
+        int exit = emitJump(OP_JUMP_IF_FALSE);
+        loops.push_back({start, {}, {}});
+        for (auto s : loop->body) statement(s);
+        emitLoop(start);
+        patchJump(exit);
+        for (int at : loops.back().breaks) patchJump(at);
+        loops.pop_back();
+        break;
+    }
+
+    case ASTNodeType::COUNTED_LOOP_STMT: {
+        // counter, limit and step stay on the stack for the whole loop, the variable gets a copy each round
+        auto loop = static_cast<CountedLoopStmt *>(node);
+        expression(loop->from);
+        expression(loop->to);
+        if (loop->step) {
+            expression(loop->step);
+        } else {
+            emitConstant(1.0);
+        }
+        int exit = emitJump(OP_FOR_PREP);
+        int top = (int)current->chunk.code.size();
+        storeVariable(loop->ref);
+        loops.push_back({-1, {}, {}});
+        for (auto s : loop->body) statement(s);
+        for (int at : loops.back().continues) patchJump(at);
+        emitOp(OP_FOR_LOOP, 0);
+        emit32((int)current->chunk.code.size() + 4 - top);
+        patchJump(exit);
+        for (int at : loops.back().breaks) patchJump(at);
+        loops.pop_back();
+        for (int i = 0; i < 3; ++i) emitOp(OP_POP, -1);
+        break;
+    }
+
+    case ASTNodeType::BREAK_STMT:
+        loops.back().breaks.push_back(emitJump(OP_JUMP));
+        break;
+
+    case ASTNodeType::CONTINUE_STMT:
+        if (loops.back().start >= 0) emitLoop(loops.back().start);
+        else loops.back().continues.push_back(emitJump(OP_JUMP));
+        break;
+
+    case ASTNodeType::FUNC_DEF: {
+        int index = compileFunction(static_cast<FuncDef *>(node), false);
+        emitOp(OP_DEFINE_FUNC, 0);
+        emit16(index);
+        break;
+    }
+
+    case ASTNodeType::CLASS_DEF: {
+        auto cl = static_cast<ClassDef *>(node);
+        for (auto &m : cl->methods) compileFunction(m, true);
+        emitOp(OP_DEFINE_CLASS, 0);
+        emit16(nameId(cl->name));
+        emit16((int)program.classes.size());
+        program.classes.push_back(cl);
+        break;
+    }
+
+    case ASTNodeType::RETURN_STMT: {
+        auto stmt = static_cast<ReturnStmt *>(node);
+        if (stmt->value) {
+            expression(stmt->value);
+        } else {
+            emitConstant(0.0);
+        }
+        emitOp(OP_RETURN, -1);
+        break;
+    }
+
+    default:
+        throw std::runtime_error("Unknown AST node type in compiler");
+    }
+}
+
+static OpCode binaryOpCode(const std::string &op) {
+    if (op == "+") return OP_ADD;
+    if (op == "-") return OP_SUB;
+    if (op == "*") return OP_MUL;
+    if (op == "/") return OP_DIV;
+    if (op == "%") return OP_MOD;
+    if (op == ">") return OP_GT;
+    if (op == "<") return OP_LT;
+    if (op == ">=") return OP_GE;
+    if (op == "<=") return OP_LE;
+    if (op == "==") return OP_EQ;
+    if (op == "!=") return OP_NEQ;
+    throw std::runtime_error("Invalid operands for binary operator: " + op);
+}
+
+void Compiler::expression(ASTNode *node) {
+    if (!node) throw std::runtime_error("Unknown expression node in compiler");
+    switch (node->type) {
+    case ASTNodeType::NUMBER:
+        emitConstant(static_cast<NumberExpr *>(node)->value);
+        break;
+
+    case ASTNodeType::STRING:
+        emitConstant(static_cast<StringExpr *>(node)->value);
+        break;
+
+    case ASTNodeType::BOOL:
+        emitConstant(static_cast<BoolExpr *>(node)->value);
+        break;
+
+    case ASTNodeType::IDENT:
+        loadVariable(static_cast<IdentExpr *>(node)->ref);
+        break;
+
+    case ASTNodeType::BINARY_EXPR: {
+        auto be = static_cast<BinaryExpr *>(node);
+        expression(be->left);
+        expression(be->right);
+        emitOp(binaryOpCode(be->op), -1);
+        break;
+    }
+
+    case ASTNodeType::UNARY_EXPR: {
+        auto ue = static_cast<UnaryExpr *>(node);
+        expression(ue->operand);
+        if (ue->op == "!") emitOp(OP_NOT, 0);
+        else if (ue->op == "-") emitOp(OP_NEGATE, 0);
+        else throw std::runtime_error("Unknown unary operator: " + ue->op);
+        break;
+    }
+
+    case ASTNodeType::INDEX_EXPR: {
+        auto ie = static_cast<IndexExpr *>(node);
+        expression(ie->target);
+        expression(ie->index);
+        emitOp(OP_INDEX, -1);
+        break;
+    }
+
+    case ASTNodeType::ARRAY_LITERAL: {
+        auto arr = static_cast<ArrayLiteral *>(node);
+        for (auto &el : arr->elements) expression(el);
+        int count = (int)arr->elements.size();
+        emitOp(OP_ARRAY, 1 - count);
+        emit16(count);
+        break;
+    }
+
+    case ASTNodeType::DICT_LITERAL: {
+        auto dict = static_cast<DictLiteral *>(node);
+        for (size_t i = 0; i < dict->keys.size(); ++i) {
+            expression(dict->keys[i]);
+            expression(dict->values[i]);
+        }
+        int count = (int)dict->keys.size();
+        emitOp(OP_DICT, 1 - 2 * count);
+        emit16(count);
+        break;
+    }
+
+    case ASTNodeType::CALL_EXPR: {
+        auto call = static_cast<CallExpr *>(node);
+        for (auto &a : call->args) expression(a);
+        int argc = (int)call->args.size();
+        emitOp(OP_CALL, 1 - argc);
+        emit16(nameId(call->callee));
+        emitArgCount(argc);
+        emit(call->calleeVar.local ? 1 : 0);
+        emit16(call->calleeVar.slot);
+        break;
+    }
+
+    case ASTNodeType::METHOD_CALL_EXPR: {
+        auto mc = static_cast<MethodCallExpr *>(node);
+        int argc = (int)mc->arguments.size();
+        if (isArrayMethod(mc->methodSymbol) && isPlace(mc->object)) {
+            int p = place(mc->object);
+            int operands = current->places[p].operands();
+            for (auto &a : mc->arguments) expression(a);
+            // calling an object's own push may need one more slot to put the receiver under the arguments
+            if (operands == 0 && depth + 1 > current->maxStack) current->maxStack = depth + 1;
+            emitOp(OP_PLACE_INVOKE, 1 - operands - argc);
+            emit16(p);
+            emit16(nameId(mc->method));
+            emitArgCount(argc);
+            emit16(addCache());
+            break;
+        }
+        expression(mc->object);
+        for (auto &a : mc->arguments) expression(a);
+        emitOp(OP_INVOKE, -argc);
+        emit16(nameId(mc->method));
+        emitArgCount(argc);
+        emit16(addCache());
+        break;
+    }
+
+    case ASTNodeType::MEMBER_ACCESS_EXPR: {
+        auto ma = static_cast<MemberAccessExpr *>(node);
+        expression(ma->object);
+        emitOp(OP_GET_MEMBER, 0);
+        emit16(nameId(ma->member));
+        emit16(addCache());
+        break;
+    }
+
+    case ASTNodeType::NEW_OBJECT_EXPR: {
+        // constructor arguments are not evaluated, same as the tree-walker
+        auto no = static_cast<NewObjectExpr *>(node);
+        emitOp(OP_NEW, 1);
+        emit16(nameId(no->className));
+        break;
+    }
+
+    default:
+        throw std::runtime_error("Unknown expression node in compiler");
+    }
+}
+
+void Compiler::emit(uint8_t byte) {
+    current->chunk.code.push_back(byte);
+}
+
+void Compiler::emit16(int value) {
+    if (value < 0 || value > 0xFFFF) throw std::runtime_error("Operand too large for bytecode");
+    emit((uint8_t)(value & 0xFF));
+    emit((uint8_t)(value >> 8));
+}
+
+void Compiler::emitOp(OpCode op, int stackEffect) {
+    emit(op);
+    depth += stackEffect;
+    if (depth > current->maxStack) current->maxStack = depth;
+}
+
+//jump offsets are 32 bit: a forward jump is emitted before we know how far it goes, and a loop
+//body is allowed to be as long as it likes
+void Compiler::emit32(int value) {
+    for (int shift = 0; shift < 32; shift += 8) emit((uint8_t)((uint32_t)value >> shift));
+}
+
+int Compiler::emitJump(OpCode op) {
+    emitOp(op, op == OP_JUMP_IF_FALSE ? -1 : op == OP_FOR_PREP ? 1 : 0);
+    emit32(0);
+    return (int)current->chunk.code.size() - 4;
+}
+
+//backward jump, relative to the byte right after the operand like forward ones
+void Compiler::emitLoop(int start) {
+    emitOp(OP_LOOP, 0);
+    emit32((int)current->chunk.code.size() + 4 - start);
+}
+
+//jumps are relative to the byte right after their operand
+void Compiler::patchJump(int at) {
+    uint32_t offset = (uint32_t)(current->chunk.code.size() - (at + 4));
+    for (int i = 0; i < 4; ++i) current->chunk.code[at + i] = (uint8_t)(offset >> (8 * i));
+}
+
+//the first 65536 constants take the short form, the rest OP_CONSTANT_LONG
+void Compiler::emitConstant(Value v) {
+    int k = addConstant(std::move(v));
+    if (k <= 0xFFFF) {
+        emitOp(OP_CONSTANT, 1);
+        emit16(k);
+        return;
+    }
+    emitOp(OP_CONSTANT_LONG, 1);
+    emit((uint8_t)(k & 0xFF));
+    emit((uint8_t)(k >> 8));
+    emit((uint8_t)(k >> 16));
+}
+
+//equal numbers, bools and string literals share one constant
+int Compiler::addConstant(Value v) {
+    auto &constants = current->chunk.constants;
+    auto found = constantIds.find(v.raw());
+    if (found != constantIds.end()) return found->second;
+    if (constants.size() >= 0x1000000) throw std::runtime_error("Too many constants in one chunk");
+    constantIds.emplace(v.raw(), (int)constants.size());
+    constants.push_back(std::move(v));
+    return (int)constants.size() - 1;
+}
+
+//argument counts are a single byte in OP_CALL / OP_INVOKE / OP_PLACE_INVOKE
+void Compiler::emitArgCount(int argc) {
+    if (argc > 0xFF) throw std::runtime_error("Too many arguments in one call (at most 255)");
+    emit((uint8_t)argc);
+}
+
+int Compiler::addCache() {
+    current->caches.emplace_back();
+    if (current->caches.size() > 0x10000) throw std::runtime_error("Too many member sites in one function");
+    return (int)current->caches.size() - 1;
+}
@@ -0,0 +1,49 @@
+// src/compiler.hpp
+//lowers the parsed AST into bytecode for the VM
+#pragma once
+#include "ast.hpp"
+#include "bytecode.hpp"
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class Compiler {
+public:
+    Program compile(NodeList<> statements);
+
+private:
+    Program program;
+    Function *current = nullptr;
+    std::unordered_map<std::string, int> nameIds;   // name ids double as global slots
+    int depth = 0;                                  // values currently on the expression stack
+    std::unordered_map<uint64_t, int> constantIds;  // constants of the current function, by Value::raw
+
+    struct LoopContext {
+        int start;                  // where yeet jumps back to in a while loop, -1 for counted loops
+        std::vector<int> breaks;    // jumps to patch to the loop exit
+        std::vector<int> continues; // forward jumps to the step of a counted loop
+    };
+    std::vector<LoopContext> loops;
+
+    int nameId(const std::string &name);
+    int compileFunction(FuncDef *fn, bool isMethod);
+
+    void statement(ASTNode *node);
+    void expression(ASTNode *node);
+    void loadVariable(const VarRef &ref);
+    void storeVariable(const VarRef &ref);
+    int place(ASTNode *node);
+
+    void emit(uint8_t byte);
+    void emit16(int value);
+    void emit32(int value);
+    void emitArgCount(int argc);
+    void emitOp(OpCode op, int stackEffect);
+    int emitJump(OpCode op);
+    void emitLoop(int start);
+    void patchJump(int at);
+    void emitConstant(Value v);
+    int addConstant(Value v);
+    int addCache();
+};
@@ -0,0 +1,134 @@
+// src/dict.cpp
+#include "dict.hpp"
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define RIZZ_DICT_SSE2 1
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+static const size_t GROUP = 16;      // slots per group, the table is always a whole number of groups
+static const uint8_t EMPTY = 0x80;   // a used slot has the high bit clear
+
+static int lowestSetBit(uint32_t mask) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (int)index;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+//bit i is set when group[i] == byte
+static uint32_t matchByte(const uint8_t *group, uint8_t byte) {
+#ifdef RIZZ_DICT_SSE2
+    __m128i g = _mm_loadu_si128(reinterpret_cast<const __m128i *>(group));
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(g, _mm_set1_epi8((char)byte)));
+#else
+    uint32_t mask = 0;
+    for (size_t i = 0; i < GROUP; ++i)
+        if (group[i] == byte) mask |= 1u << i;
+    return mask;
+#endif
+}
+
+//the low bits of FNV alone cluster on similar keys, this spreads them over the whole word
+static uint64_t mix(uint64_t h) {
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ull;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebull;
+    return h ^ (h >> 31);
+}
+
+static uint64_t hashKey(const Value &key) {
+    if (key.isNumber()) {
+        double d = key.asNumber();
+        if (d == 0) d = 0; // -0 is the same key as 0
+        uint64_t bits;
+        std::memcpy(&bits, &d, sizeof bits);
+        return mix(bits);
+    }
+    if (key.isString()) {
+        uint64_t h = 14695981039346656037ull;
+        for (unsigned char c : key.asString()) {
+            h ^= c;
+            h *= 1099511628211ull;
+        }
+        return mix(h);
+    }
+    throw std::runtime_error("Dict keys must be strings or numbers");
+}
+
+static bool sameKey(const Value &a, const Value &b) {
+    if (a.isNumber()) {
+        if (!b.isNumber()) return false;
+        double x = a.asNumber();
+        double y = b.asNumber();
+        return x == y || (x != x && y != y);
+    }
+    return b.isString() && a.asString() == b.asString();
+}
+
+// Groups are probed in triangular steps (1, 2, 3, ... groups further each time), which visits
+// every group once when their count is a power of two. The low 7 bits of the hash go in the
+// control byte, the rest picks the first group.
+
+Value *DictObj::find(const Value &key) {
+    return lookup(key, hashKey(key));
+}
+
+Value *DictObj::lookup(const Value &key, uint64_t hash) {
+    if (ctrl.empty()) return nullptr;
+    size_t groupMask = ctrl.size() / GROUP - 1;
+    size_t g = (size_t)(hash >> 7) & groupMask;
+    uint8_t tag = (uint8_t)(hash & 0x7f);
+    for (size_t step = 1;; ++step) {
+        const uint8_t *group = &ctrl[g * GROUP];
+        for (uint32_t m = matchByte(group, tag); m; m &= m - 1) {
+            Entry &e = entries[slots[g * GROUP + lowestSetBit(m)]];
+            if (e.hash == hash && sameKey(e.key, key)) return &e.value;
+        }
+        if (matchByte(group, EMPTY)) return nullptr; // the key would have gone in that free slot
+        g = (g + step) & groupMask;
+    }
+}
+
+void DictObj::insertSlot(uint64_t hash, uint32_t entry) {
+    size_t groupMask = ctrl.size() / GROUP - 1;
+    size_t g = (size_t)(hash >> 7) & groupMask;
+    for (size_t step = 1;; ++step) {
+        if (uint32_t free = matchByte(&ctrl[g * GROUP], EMPTY)) {
+            size_t slot = g * GROUP + lowestSetBit(free);
+            ctrl[slot] = (uint8_t)(hash & 0x7f);
+            slots[slot] = entry;
+            return;
+        }
+        g = (g + step) & groupMask;
+    }
+}
+
+//doubles the slots and puts every entry back, the entries themselves never move
+void DictObj::grow() {
+    size_t capacity = ctrl.empty() ? GROUP : ctrl.size() * 2;
+    ctrl.assign(capacity, EMPTY);
+    slots.assign(capacity, 0);
+    for (size_t i = 0; i < entries.size(); ++i) insertSlot(entries[i].hash, (uint32_t)i);
+}
+
+void DictObj::set(const Value &key, Value value) {
+    uint64_t hash = hashKey(key);
+    if (Value *existing = lookup(key, hash)) {
+        *existing = std::move(value);
+        return;
+    }
+    // at most 7/8 of the slots in use, so every probe soon meets a group with a free slot
+    if ((entries.size() + 1) * 8 > ctrl.size() * 7) grow();
+    entries.push_back({key, std::move(value), hash});
+    insertSlot(hash, (uint32_t)(entries.size() - 1));
+}
@@ -0,0 +1,35 @@
+// src/dict.hpp
+//rizz dictionaries: {"key": value}, read with d[key] and written with d[key] = value.
+//Keys are strings or numbers. Like objects, a dict is shared by everything holding it.
+#pragma once
+#include "value.hpp"
+#include <cstdint>
+#include <vector>
+
+// Entries sit in one array in the order they were added, which is the order they print in.
+// The index over them is open addressing in the Swiss table style: every slot has a control byte
+// holding 7 bits of its key's hash, a lookup checks a whole group of 16 control bytes at once and
+// only compares the keys whose bits match. Nothing is allocated per entry.
+struct DictObj : Obj {
+    struct Entry {
+        Value key;
+        Value value;
+        uint64_t hash;
+    };
+    std::vector<Entry> entries;
+
+    DictObj() : Obj(ObjType::DICT) {}
+
+    Value *find(const Value &key);          // nullptr when the key is not there
+    void set(const Value &key, Value value);
+
+private:
+    std::vector<uint8_t> ctrl;      // per slot: empty, or the low 7 bits of the hash
+    std::vector<uint32_t> slots;    // per slot: the entry it points at
+
+    Value *lookup(const Value &key, uint64_t hash);
+    void insertSlot(uint64_t hash, uint32_t entry);
+    void grow();
+};
+
+inline Value makeDict() { return Value(new DictObj()); }
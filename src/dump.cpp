@@ -0,0 +1,249 @@
+// src/dump.cpp
+#include "dump.hpp"
+#include "number.hpp"
+#include "parser.hpp"
+#include <string>
+
+//shortest text that reads back as the same double, so folded results show exactly
+static void dumpNumber(std::ostream &out, double d) {
+    char buf[NUMBER_CHARS];
+    out.write(buf, (std::streamsize)formatNumber(buf, d));
+}
+
+static void dumpExpression(std::ostream &out, const ASTNode *node);
+
+static void dumpArguments(std::ostream &out, NodeList<> args) {
+    out << "(";
+    for (size_t i = 0; i < args.size(); ++i) {
+        if (i) out << ", ";
+        dumpExpression(out, args[i]);
+    }
+    out << ")";
+}
+
+static void dumpExpression(std::ostream &out, const ASTNode *node) {
+    switch (node->type) {
+    case ASTNodeType::NUMBER:
+        dumpNumber(out, static_cast<const NumberExpr *>(node)->value);
+        break;
+    case ASTNodeType::STRING:
+        out << '"' << static_cast<const StringExpr *>(node)->value.asString() << '"';
+        break;
+    case ASTNodeType::BOOL:
+        out << (static_cast<const BoolExpr *>(node)->value ? "no_cap" : "cap");
+        break;
+    case ASTNodeType::IDENT:
+        out << static_cast<const IdentExpr *>(node)->name;
+        break;
+    case ASTNodeType::BINARY_EXPR: {
+        auto be = static_cast<const BinaryExpr *>(node);
+        out << "(";
+        dumpExpression(out, be->left);
+        out << " " << be->op << " ";
+        dumpExpression(out, be->right);
+        out << ")";
+        break;
+    }
+    case ASTNodeType::UNARY_EXPR: {
+        auto ue = static_cast<const UnaryExpr *>(node);
+        out << ue->op;
+        dumpExpression(out, ue->operand);
+        break;
+    }
+    case ASTNodeType::INDEX_EXPR: {
+        auto ie = static_cast<const IndexExpr *>(node);
+        dumpExpression(out, ie->target);
+        out << "[";
+        dumpExpression(out, ie->index);
+        out << "]";
+        break;
+    }
+    case ASTNodeType::CALL_EXPR: {
+        auto call = static_cast<const CallExpr *>(node);
+        out << call->callee;
+        dumpArguments(out, call->args);
+        break;
+    }
+    case ASTNodeType::NEW_OBJECT_EXPR: {
+        auto no = static_cast<const NewObjectExpr *>(node);
+        out << "pullup " << no->className;
+        dumpArguments(out, no->args);
+        break;
+    }
+    case ASTNodeType::METHOD_CALL_EXPR: {
+        auto mc = static_cast<const MethodCallExpr *>(node);
+        dumpExpression(out, mc->object);
+        out << "." << mc->method;
+        dumpArguments(out, mc->arguments);
+        break;
+    }
+    case ASTNodeType::MEMBER_ACCESS_EXPR: {
+        auto ma = static_cast<const MemberAccessExpr *>(node);
+        dumpExpression(out, ma->object);
+        out << "." << ma->member;
+        break;
+    }
+    case ASTNodeType::ARRAY_LITERAL: {
+        auto arr = static_cast<const ArrayLiteral *>(node);
+        out << "[";
+        for (size_t i = 0; i < arr->elements.size(); ++i) {
+            if (i) out << ", ";
+            dumpExpression(out, arr->elements[i]);
+        }
+        out << "]";
+        break;
+    }
+    case ASTNodeType::DICT_LITERAL: {
+        auto dict = static_cast<const DictLiteral *>(node);
+        out << "{";
+        for (size_t i = 0; i < dict->keys.size(); ++i) {
+            if (i) out << ", ";
+            dumpExpression(out, dict->keys[i]);
+            out << ": ";
+            dumpExpression(out, dict->values[i]);
+        }
+        out << "}";
+        break;
+    }
+    default:
+        out << "<?>";
+        break;
+    }
+}
+
+static void dumpBlock(std::ostream &out, NodeList<> statements, int depth);
+
+static void dumpFunction(std::ostream &out, FuncDef *fn, int depth) {
+    parseDeferredBody(*fn);
+    std::string indent(depth * 4, ' ');
+    out << indent << "drip " << fn->name << "(";
+    for (size_t i = 0; i < fn->params.size(); ++i) out << (i ? ", " : "") << fn->params[i];
+    out << "):\n";
+    dumpBlock(out, fn->body, depth + 1);
+    out << indent << "finna\n";
+}
+
+static void dumpStatement(std::ostream &out, ASTNode *node, int depth) {
+    std::string indent(depth * 4, ' ');
+    switch (node->type) {
+    case ASTNodeType::PRINT_STMT:
+        out << indent << "bruh ";
+        dumpExpression(out, static_cast<PrintStmt *>(node)->value);
+        out << "\n";
+        break;
+    case ASTNodeType::ASSIGN_STMT: {
+        auto stmt = static_cast<AssignStmt *>(node);
+        out << indent << stmt->name << " = ";
+        dumpExpression(out, stmt->value);
+        out << "\n";
+        break;
+    }
+    case ASTNodeType::MEMBER_ASSIGN_STMT: {
+        auto stmt = static_cast<MemberAssignStmt *>(node);
+        out << indent;
+        dumpExpression(out, stmt->object);
+        out << "." << stmt->member << " = ";
+        dumpExpression(out, stmt->value);
+        out << "\n";
+        break;
+    }
+    case ASTNodeType::INDEX_ASSIGN_STMT: {
+        auto stmt = static_cast<IndexAssignStmt *>(node);
+        out << indent;
+        dumpExpression(out, stmt->target);
+        out << "[";
+        dumpExpression(out, stmt->index);
+        out << "] = ";
+        dumpExpression(out, stmt->value);
+        out << "\n";
+        break;
+    }
+    case ASTNodeType::EXPR_STMT:
+        out << indent;
+        dumpExpression(out, static_cast<ExprStmt *>(node)->expr);
+        out << "\n";
+        break;
+    case ASTNodeType::INPUT_STMT:
+        out << indent << "spill " << static_cast<InputStmt *>(node)->varName << "\n";
+        break;
+    case ASTNodeType::IF_STMT: {
+        auto first = static_cast<IfStmt *>(node);
+        for (auto branch = first; branch; branch = branch->next) {
+            if (!branch->condition) {
+                out << indent << "forReal:\n";
+            } else {
+                out << indent << (branch == first ? "bet " : "noFam ");
+                dumpExpression(out, branch->condition);
+                out << ":\n";
+            }
+            dumpBlock(out, branch->thenBranch, depth + 1);
+        }
+        out << indent << "yikes\n";
+        break;
+    }
+    case ASTNodeType::LOOP_STMT: {
+        auto loop = static_cast<LoopStmt *>(node);
+        out << indent << "loop ";
+        dumpExpression(out, loop->condition);
+        out << ":\n";
+        dumpBlock(out, loop->body, depth + 1);
+        out << indent << "periodt\n";
+        break;
+    }
+    case ASTNodeType::COUNTED_LOOP_STMT: {
+        auto loop = static_cast<CountedLoopStmt *>(node);
+        out << indent << "loop " << loop->varName << " = ";
+        dumpExpression(out, loop->from);
+        out << ", ";
+        dumpExpression(out, loop->to);
+        if (loop->step) {
+            out << ", ";
+            dumpExpression(out, loop->step);
+        }
+        out << ":\n";
+        dumpBlock(out, loop->body, depth + 1);
+        out << indent << "periodt\n";
+        break;
+    }
+    case ASTNodeType::BREAK_STMT:
+        out << indent << "sybau\n";
+        break;
+    case ASTNodeType::CONTINUE_STMT:
+        out << indent << "yeet\n";
+        break;
+    case ASTNodeType::RETURN_STMT: {
+        auto stmt = static_cast<ReturnStmt *>(node);
+        out << indent << "return";
+        if (stmt->value) {
+            out << " ";
+            dumpExpression(out, stmt->value);
+        }
+        out << "\n";
+        break;
+    }
+    case ASTNodeType::FUNC_DEF:
+        dumpFunction(out, static_cast<FuncDef *>(node), depth);
+        break;
+    case ASTNodeType::CLASS_DEF: {
+        auto cl = static_cast<ClassDef *>(node);
+        out << indent << "rizz " << cl->name << ":\n";
+        for (auto m : cl->methods) dumpFunction(out, m, depth + 1);
+        out << indent << "goner\n";
+        break;
+    }
+    default:
+        out << indent;
+        dumpExpression(out, node);
+        out << "\n";
+        break;
+    }
+}
+
+static void dumpBlock(std::ostream &out, NodeList<> statements, int depth) {
+    for (auto stmt : statements)
+        if (stmt) dumpStatement(out, stmt, depth);
+}
+
+void dumpScript(std::ostream &out, NodeList<> statements) {
+    dumpBlock(out, statements, 0);
+}
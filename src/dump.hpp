@@ -0,0 +1,9 @@
+// src/dump.hpp
+//prints an AST back as rizz code, every binary operation in parentheses so the grouping shows.
+//Used by --dump-optimized to see what the Optimizer made of a script.
+#pragma once
+#include "ast.hpp"
+#include <ostream>
+
+//drips that are still deferred get parsed first so their bodies show too
+void dumpScript(std::ostream &out, NodeList<> statements);
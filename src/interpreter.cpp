@@ -1,316 +1,466 @@
 #include "interpreter.hpp"
-#include <iostream>
+#include "dict.hpp"
 #include <stdexcept>
 #include <cmath>
 
-Interpreter::Value Interpreter::callFunction(
-    const std::shared_ptr<FuncDef>& fn,
-    const std::vector<Value>& args,
-    const std::shared_ptr<Instance>& self)
-{
-    if (!fn) throw std::runtime_error("callFunction: null function");
-    if (args.size() != fn->params.size())
+Value &Frames::placeRoot(const IdentExpr *e) {
+    Value &v = slot(e->ref);
+    if (v.isUndefined()) v = read(e->ref, e->name); // a local not assigned yet starts as the global it shadows
+    return v;
+}
+
+void Frames::checkArguments(const FuncDef *fn, size_t argBase) {
+    if (stack.size() - argBase != fn->params.size()) {
+        stack.resize(argBase);
         throw std::runtime_error("Argument count mismatch in call to " + fn->name);
+    }
+}
+
+Frames::Caller Frames::enter(const FuncDef *fn, size_t argBase, const Value &self) {
+    stack.resize(argBase + fn->numLocals);
+    if (self.isInstance() && fn->selfSlot >= 0) stack[argBase + fn->selfSlot] = self;
+    Caller caller{base, function};
+    base = argBase;
+    function = fn;
+    return caller;
+}
 
-    auto oldVars = variables;
-    for (size_t i = 0; i < fn->params.size(); ++i) {
-        variables[fn->params[i]] = args[i];
+void Frames::leave(const Caller &caller, size_t argBase) {
+    base = caller.base;
+    function = caller.function;
+    stack.resize(argBase);
+}
+
+const Value &Frames::drip(const std::string &name) const {
+    Symbol symbol = internSymbol(name);
+    if (symbol >= drips.items.size() || drips.items[symbol].isUndefined()) undefined(name);
+    return drips.items[symbol];
+}
+
+void Frames::undefined(const std::string &name) {
+    throw std::runtime_error("Undefined variable: " + name);
+}
+
+FuncDef *methodFor(MethodCallExpr *mc, const Value &obj) {
+    FuncDef *method = findMethod(mc->cache, instanceOf(obj, "call method"), mc->methodSymbol);
+    if (!method) throw std::runtime_error("Unknown method: " + mc->method);
+    return method;
+}
+
+FuncDef *constructorOrBuiltin(const CallExpr *call, const Value &callee, Builtin &builtin) {
+    if (callee.isFunction()) return callee.asFunction()->fn;
+    if (callee.isInstance()) {
+        if (FuncDef *init = callee.asInstance()->getClass()->findMethod(SYMBOL_INIT)) return init;
     }
-    if (self) variables["self"] = self;
+    if (!(builtin = findBuiltin(call->calleeSymbol))) throw std::runtime_error("Undefined lol: " + call->callee);
+    return nullptr;
+}
 
-    try {
-        for (auto &stmt : fn->body) {
-            executeNode(stmt);
+Value newObject(const SymbolMap<Value> &classes, const NewObjectExpr *no) {
+    Value klass = classes.get(no->classSymbol);
+    if (!klass.isClass()) throw std::runtime_error("Class not found: " + no->className);
+    return Value(new InstanceObj(klass)); // methods stay on the class, no per object copy
+}
+
+Value &fieldPlace(MemberAccessExpr *ma, const Value &obj) {
+    return *fieldSlot(ma->cache, instanceOf(obj, "access member"), ma->memberSymbol);
+}
+
+//the counter lives in a plain double, the loop variable only gets a copy of it each round,
+//so assigning to it in the body does not change how often the loop runs
+LoopRange loopRange(const Value &from, const Value &to, const Value &step) {
+    if (!from.isNumber() || !to.isNumber() || !step.isNumber())
+        throw std::runtime_error("Loop bounds must be numbers");
+    if (step.asNumber() == 0.0) throw std::runtime_error("Loop step can't be 0");
+    return {from.asNumber(), to.asNumber(), step.asNumber()};
+}
+
+//the arguments were pushed with pushArguments and become the first slots of the callee's frame
+Interpreter::Value Interpreter::callFunction(
+    FuncDef *fn,
+    size_t base,
+    const Value& self)
+{
+    if (!fn) throw std::runtime_error("callFunction: null function");
+    frames.checkArguments(fn, base);
+    if (fn->deferred) {
+        // first call: parse and resolve the body now, it may bring new globals with it
+        try {
+            resolver.resolveBody(*fn);
+        } catch (...) {
+            frames.stack.resize(base);
+            throw;
         }
-    } catch (Interpreter::Value &retVal) {
-        variables = oldVars;
-        return retVal;
+        frames.globals.resize(resolver.globalNames().size());
     }
 
-    variables = oldVars;
-    return 0.0;
+    Frames::Caller caller = frames.enter(fn, base, self);
+    Value result = 0.0;
+    if (executeBlock(fn->body) == ExecSignal::Return) {
+        result = std::move(returnValue);
+    }
+    frames.leave(caller, base);
+    return result;
+}
+
+//a drip called by a builtin like map
+Interpreter::Value Interpreter::call(FuncDef *fn, const Value *args, size_t argc) {
+    size_t base = frames.stack.size();
+    frames.stack.insert(frames.stack.end(), args, args + argc);
+    return callFunction(fn, base, Value());
+}
+
+//evaluates call arguments straight onto the stack, no vector per call; returns where they start
+size_t Interpreter::pushArguments(NodeList<> args) {
+    size_t base = frames.stack.size();
+    for (auto a : args) {
+        Value v = evalExpression(a); // may run other calls, which leave the stack as they found it
+        frames.stack.push_back(std::move(v));
+    }
+    return base;
 }
 
 // Entry point
-void Interpreter::execute(const std::vector<std::shared_ptr<ASTNode>> &statements) {
-    for (auto &stmt : statements) executeNode(stmt);
+void Interpreter::execute(NodeList<> statements) {
+    resolver.deferBodies = true;
+    resolver.resolve(statements);
+    frames.globals.assign(resolver.globalNames().size(), Value());
+
+    executeBlock(statements); // a return at top level just ends the script
 }
 
-void Interpreter::executeNode(const std::shared_ptr<ASTNode> &node) {
+ExecSignal Interpreter::executeBlock(NodeList<> statements) {
+    for (auto &stmt : statements) {
+        ExecSignal signal = executeNode(stmt);
+        if (signal != ExecSignal::Normal) return signal;
+    }
+    return ExecSignal::Normal;
+}
+
+// A place (see isPlace) is reached in two steps. placeOperands evaluates, in source order, what the
+// way there depends on: the object of a field and every index. placeSlot then walks to the slot
+// with those, evaluating nothing, so no call can move the stack under the slot it hands out.
+void Interpreter::placeOperands(ASTNode *place, std::vector<Value> &operands) {
+    if (place->type == ASTNodeType::MEMBER_ACCESS_EXPR) {
+        operands.push_back(evalExpression(static_cast<MemberAccessExpr *>(place)->object));
+    } else if (place->type == ASTNodeType::INDEX_EXPR) {
+        auto ie = static_cast<IndexExpr *>(place);
+        placeOperands(ie->target, operands);
+        operands.push_back(evalExpression(ie->index));
+    }
+}
+
+Interpreter::Value &Interpreter::placeSlot(ASTNode *place, const Value *&operand) {
+    if (place->type == ASTNodeType::IDENT) return frames.placeRoot(static_cast<IdentExpr *>(place));
+    if (place->type == ASTNodeType::MEMBER_ACCESS_EXPR)
+        return fieldPlace(static_cast<MemberAccessExpr *>(place), *operand++);
+    auto ie = static_cast<IndexExpr *>(place);
+    Value &container = placeSlot(ie->target, operand);
+    return *elementSlot(container, *operand++);
+}
+
+ExecSignal Interpreter::executeNode(ASTNode *node) {
     switch (node->type) {
     case ASTNodeType::PRINT_STMT: {
-        auto stmt = std::dynamic_pointer_cast<PrintStmt>(node);
-        auto val = evalExpression(stmt->value);
-        if (std::holds_alternative<double>(val)) std::cout << std::get<double>(val) << std::endl;
-        else if (std::holds_alternative<std::string>(val)) std::cout << std::get<std::string>(val) << std::endl;
-        else if (std::holds_alternative<bool>(val)) std::cout << (std::get<bool>(val) ? "no_cap" : "cap") << std::endl;
-        else if (std::holds_alternative<std::shared_ptr<Instance>>(val)) std::cout << "<object>" << std::endl;
-         else if (std::holds_alternative<Array>(val)) {
-        auto &arr = std::get<Array>(val);
-        std::cout << "[";
-        for (size_t i = 0; i < arr.size(); ++i) {
-            // recursively print elements (simplest: only numbers/strings)
-            if (std::holds_alternative<double>(arr[i])) std::cout << std::get<double>(arr[i]);
-            else if (std::holds_alternative<std::string>(arr[i])) std::cout << '"' << std::get<std::string>(arr[i]) << '"';
-            else if (std::holds_alternative<bool>(arr[i])) std::cout << (std::get<bool>(arr[i]) ? "true" : "false");
-            if (i + 1 < arr.size()) std::cout << ", ";
-        }
-        std::cout << "]"<<std::endl;
-    }
+        auto stmt = static_cast<PrintStmt *>(node);
+        printValue(out, evalExpression(stmt->value));
         break;
     }
 
     case ASTNodeType::ASSIGN_STMT: {
-        auto stmt = std::dynamic_pointer_cast<AssignStmt>(node);
+        auto stmt = static_cast<AssignStmt *>(node);
         auto val = evalExpression(stmt->value);
-        variables[stmt->name] = val;
+        frames.slot(stmt->ref) = std::move(val);
         break;
     }
 
     case ASTNodeType::IF_STMT: {
-        auto stmt = std::dynamic_pointer_cast<IfStmt>(node);
+        auto stmt = static_cast<IfStmt *>(node);
         auto current = stmt;
         while (current) {
-            bool condResult = false;
-            if (current->condition) {
-                auto condVal = evalExpression(current->condition);
-                if (std::holds_alternative<bool>(condVal)) condResult = std::get<bool>(condVal);
-                else if (std::holds_alternative<double>(condVal)) condResult = (std::get<double>(condVal) != 0.0);
-                else if (std::holds_alternative<std::string>(condVal)) condResult = !std::get<std::string>(condVal).empty();
-                else condResult = true;
-            } else {
-                condResult = true;
-            }
-            if (condResult) {
-                for (auto &c : current->thenBranch) executeNode(c);
-                return;
-            }
+            bool condResult = true;
+            if (current->condition) condResult = isTruthy(evalExpression(current->condition));
+            if (condResult) return executeBlock(current->thenBranch);
             current = current->next;
         }
         break;
     }
 
+    case ASTNodeType::LOOP_STMT: {
+        auto loop = static_cast<LoopStmt *>(node);
+        while (isTruthy(evalExpression(loop->condition))) {
+            ExecSignal signal = executeBlock(loop->body);
+            if (signal == ExecSignal::Break) break;
+            if (signal == ExecSignal::Return) return signal;
+        }
+        break;
+    }
+
+    case ASTNodeType::COUNTED_LOOP_STMT:
+        return executeCountedLoop(static_cast<CountedLoopStmt *>(node));
+
+    case ASTNodeType::BREAK_STMT:
+        return ExecSignal::Break;
+
+    case ASTNodeType::CONTINUE_STMT:
+        return ExecSignal::Continue;
+
     case ASTNodeType::FUNC_DEF: {
-        auto fn = std::dynamic_pointer_cast<FuncDef>(node);
-        functions[fn->name] = fn;
+        auto fn = static_cast<FuncDef *>(node);
+        functions[fn->symbol] = fn;
+        frames.drips[fn->symbol] = Value(new FunctionObj(fn));
         break;
     }
 
     case ASTNodeType::CLASS_DEF: {
-        auto cl = std::dynamic_pointer_cast<ClassDef>(node);
-        classes[cl->name] = cl;
+        auto cl = static_cast<ClassDef *>(node);
+        classes[cl->symbol] = makeClass(*cl);
             // std::cerr << "[DEBUG] Registered class: " << cl->name << " with " << cl->methods.size() << " methods\n";
             break;
     }
 
     case ASTNodeType::RETURN_STMT: {
-        auto stmt = std::dynamic_pointer_cast<ReturnStmt>(node);
-        throw evalExpression(stmt->value);
+        auto stmt = static_cast<ReturnStmt *>(node);
+        returnValue = stmt->value ? evalExpression(stmt->value) : Value(0.0);
+        return ExecSignal::Return;
     }
 
     case ASTNodeType::EXPR_STMT: {
-        auto stmt = std::dynamic_pointer_cast<ExprStmt>(node);
+        auto stmt = static_cast<ExprStmt *>(node);
         evalExpression(stmt->expr);
         break;
     }
 
-    case ASTNodeType::INPUT_STMT:
-        executeInput(std::dynamic_pointer_cast<InputStmt>(node));
+    case ASTNodeType::MEMBER_ASSIGN_STMT: {
+        auto stmt = static_cast<MemberAssignStmt *>(node);
+        Value obj = evalExpression(stmt->object);
+        setMember(stmt->cache, instanceOf(obj, "set member"), stmt->memberSymbol, evalExpression(stmt->value));
         break;
+    }
+
+    case ASTNodeType::INDEX_ASSIGN_STMT: {
+        auto stmt = static_cast<IndexAssignStmt *>(node);
+        if (!isPlace(stmt->target)) {
+            // f()[k] = v: only changes something when f() gave a dict
+            Value target = evalExpression(stmt->target);
+            Value index = evalExpression(stmt->index);
+            assignIndex(target, index, evalExpression(stmt->value));
+            break;
+        }
+        std::vector<Value> operands;
+        placeOperands(stmt->target, operands);
+        Value index = evalExpression(stmt->index);
+        Value value = evalExpression(stmt->value);
+        const Value *operand = operands.data();
+        assignIndex(placeSlot(stmt->target, operand), index, std::move(value));
+        break;
+    }
+
+    case ASTNodeType::INPUT_STMT: {
+        auto stmt = static_cast<InputStmt *>(node);
+        Value val = readInput(out, stmt->varName);
+        frames.slot(stmt->ref) = std::move(val);
+        break;
+    }
 
     default:
         throw std::runtime_error("Unknown AST node type in executeNode");
     }
+    return ExecSignal::Normal;
 }
 
-void Interpreter::executeInput(const std::shared_ptr<InputStmt> &stmt) {
-    std::cout << "📝 spill " << stmt->varName << ": ";
-    std::string s;
-    std::getline(std::cin, s);
-    try {
-        variables[stmt->varName] = std::stod(s);
-    } catch (...) {
-        variables[stmt->varName] = s;
+ExecSignal Interpreter::executeCountedLoop(CountedLoopStmt *loop) {
+    Value from = evalExpression(loop->from);
+    Value to = evalExpression(loop->to);
+    Value step = loop->step ? evalExpression(loop->step) : Value(1.0);
+    LoopRange range = loopRange(from, to, step);
+
+    for (double i = range.from; range.more(i); i += range.by) {
+        frames.slot(loop->ref) = i;
+        ExecSignal signal = executeBlock(loop->body);
+        if (signal == ExecSignal::Break) break;
+        if (signal == ExecSignal::Return) return signal;
     }
+    return ExecSignal::Normal;
 }
 
-Interpreter::Value Interpreter::evalExpression(const std::shared_ptr<ASTNode> &node) {
+//a + b and friends on two numbers, op is never OTHER
+static Value numericBinary(BinaryOp op, double l, double r) {
+    switch (op) {
+    case BinaryOp::ADD: return l + r;
+    case BinaryOp::SUB: return l - r;
+    case BinaryOp::MUL: return l * r;
+    case BinaryOp::DIV: return l / r;
+    case BinaryOp::MOD: return std::fmod(l, r);
+    case BinaryOp::GT: return l > r;
+    case BinaryOp::LT: return l < r;
+    case BinaryOp::GE: return l >= r;
+    case BinaryOp::LE: return l <= r;
+    case BinaryOp::EQ: return l == r;
+    case BinaryOp::NEQ: return l != r;
+    default: throw std::runtime_error("Unknown binary operator");
+    }
+}
+
+Interpreter::Value Interpreter::evalExpression(ASTNode *node) {
     switch (node->type) {
     case ASTNodeType::NUMBER:
-        return std::dynamic_pointer_cast<NumberExpr>(node)->value;
+        return static_cast<NumberExpr *>(node)->value;
 
     case ASTNodeType::STRING:
-        return std::dynamic_pointer_cast<StringExpr>(node)->value;
+        return static_cast<StringExpr *>(node)->value;
+
+    case ASTNodeType::BOOL:
+        return static_cast<BoolExpr *>(node)->value;
 
     case ASTNodeType::IDENT: {
-        auto e = std::dynamic_pointer_cast<IdentExpr>(node);
-        if (variables.find(e->name) == variables.end())
-            throw std::runtime_error("Undefined variable: " + e->name);
-        return variables[e->name];
+        auto e = static_cast<IdentExpr *>(node);
+        return frames.read(e->ref, e->name);
     }
 
     case ASTNodeType::CALL_EXPR: {
-        auto call = std::dynamic_pointer_cast<CallExpr>(node);
+        auto call = static_cast<CallExpr *>(node);
 
         // 1. Look in global functions
-        auto it = functions.find(call->callee);
-        if (it != functions.end()) {
-            std::vector<Value> argVals;
-            for (auto &a : call->args) argVals.push_back(evalExpression(a));
-            return callFunction(it->second, argVals, nullptr);
-        }
-
-        auto varIt = variables.find(call->callee);
-        if (varIt != variables.end() && 
-            std::holds_alternative<std::shared_ptr<Instance>>(varIt->second)) {
-            
-            auto instance = std::get<std::shared_ptr<Instance>>(varIt->second);
-            auto methodIt = instance->methods.find("init");
-            if (methodIt != instance->methods.end()) {
-                std::vector<Value> argVals;
-                for (auto &a : call->args) argVals.push_back(evalExpression(a));
-                return callFunction(methodIt->second, argVals, instance);
-            }
-        }
-
-        throw std::runtime_error("Undefined lol: " + call->callee);
+        if (FuncDef *target = functions.get(call->calleeSymbol))
+            return callFunction(target, pushArguments(call->args), Value());
+
+        Value callee = frames.slot(call->calleeVar);
+        Builtin builtin = nullptr;
+        if (FuncDef *init = constructorOrBuiltin(call, callee, builtin))
+            return callFunction(init, pushArguments(call->args), callee);
+        size_t base = pushArguments(call->args);
+        Value result = builtin(frames.stack.data() + base, frames.stack.size() - base, *this);
+        frames.stack.resize(base);
+        return result;
     }
 
     case ASTNodeType::NEW_OBJECT_EXPR: {
-        auto no = std::dynamic_pointer_cast<NewObjectExpr>(node);
-        auto cit = classes.find(no->className);
-        if (cit == classes.end()) throw std::runtime_error("Class not found: " + no->className);
-        auto cl = cit->second;
-        auto inst = std::make_shared<Instance>();
-        for (auto &m : cl->methods) {
-        inst->methods[m->name] = m;
-        // std::cerr << "[DEBUG] Instance of " << cl->name << " stored method: " << m->name << "\n";
-    }
-        return inst;
+        return newObject(classes, static_cast<NewObjectExpr *>(node));
     }
 
     case ASTNodeType::BINARY_EXPR: {
-        auto be = std::dynamic_pointer_cast<BinaryExpr>(node);
+        auto be = static_cast<BinaryExpr *>(node);
         auto L = evalExpression(be->left);
         auto R = evalExpression(be->right);
 
-        if (std::holds_alternative<double>(L) && std::holds_alternative<double>(R)) {
-            double l = std::get<double>(L);
-            double r = std::get<double>(R);
-            if (be->op == "+") return l + r;
-            if (be->op == "-") return l - r;
-            if (be->op == "*") return l * r;
-            if (be->op == "/") return l / r;
-            if (be->op == "%") return std::fmod(l, r);
-            if (be->op == ">") return l > r;
-            if (be->op == "<") return l < r;
-            if (be->op == ">=") return l >= r;
-            if (be->op == "<=") return l <= r;
-            if (be->op == "==") return l == r;
-            if (be->op == "!=") return l != r;
+        // quickened: one guard for the two numbers and the operator is already known.
+        // Anything else turns the node generic for good.
+        switch (be->quick) {
+#define QUICK_BINARY(quickOp, expr)                                    \
+        case QuickOp::quickOp:                                         \
+            if (L.isNumber() && R.isNumber()) {                        \
+                double l = L.asNumber();                               \
+                double r = R.asNumber();                               \
+                return expr;                                           \
+            }                                                          \
+            be->quick = QuickOp::GENERIC;                              \
+            return concatValues(be->op, L, R);
+        QUICK_BINARY(NUM_ADD, l + r)
+        QUICK_BINARY(NUM_SUB, l - r)
+        QUICK_BINARY(NUM_MUL, l * r)
+        QUICK_BINARY(NUM_DIV, l / r)
+        QUICK_BINARY(NUM_MOD, std::fmod(l, r))
+        QUICK_BINARY(NUM_GT, l > r)
+        QUICK_BINARY(NUM_LT, l < r)
+        QUICK_BINARY(NUM_GE, l >= r)
+        QUICK_BINARY(NUM_LE, l <= r)
+        QUICK_BINARY(NUM_EQ, l == r)
+        QUICK_BINARY(NUM_NEQ, l != r)
+#undef QUICK_BINARY
+        case QuickOp::UNSEEN:
+        case QuickOp::GENERIC:
+            break;
         }
-            if (be->op == "+" && std::holds_alternative<std::string>(L) && std::holds_alternative<std::string>(R)) {
-                return std::get<std::string>(L) + std::get<std::string>(R);
-            }
 
-            if (be->op == "+" && std::holds_alternative<std::string>(L) && std::holds_alternative<double>(R)) {
-                return std::get<std::string>(L) + std::to_string(std::get<double>(R));
-            }
-            if (be->op == "+" && std::holds_alternative<double>(L) && std::holds_alternative<std::string>(R)) {
-                return std::to_string(std::get<double>(L)) + std::get<std::string>(R);
-            }
-        throw std::runtime_error("Invalid operands for binary operator: " + be->op);
+        if (L.isNumber() && R.isNumber() && be->opcode != BinaryOp::OTHER) {
+            // numbers: from now on the node runs as the numeric form of its operator
+            if (be->quick == QuickOp::UNSEEN) be->quick = (QuickOp)be->opcode;
+            return numericBinary(be->opcode, L.asNumber(), R.asNumber());
+        }
+        return concatValues(be->op, L, R);
     }
 
     case ASTNodeType::UNARY_EXPR: {
-        auto ue = std::dynamic_pointer_cast<UnaryExpr>(node);
+        auto ue = static_cast<UnaryExpr *>(node);
         auto v = evalExpression(ue->operand);
-        if (ue->op == "!") {
-            if (std::holds_alternative<bool>(v)) return !std::get<bool>(v);
-            if (std::holds_alternative<double>(v)) return std::get<double>(v) == 0.0;
-            throw std::runtime_error("Invalid operand type for '!'");
-        } else if (ue->op == "-") {
-            if (std::holds_alternative<double>(v)) return -std::get<double>(v);
-            throw std::runtime_error("Invalid operand type for unary '-'");
-        }
+        if (ue->op == "!") return logicalNot(v);
+        if (ue->op == "-") return negate(v);
         throw std::runtime_error("Unknown unary operator: " + ue->op);
     }
     case ASTNodeType::MEMBER_ACCESS_EXPR: {
-    auto ma = std::dynamic_pointer_cast<MemberAccessExpr>(node);
+    auto ma = static_cast<MemberAccessExpr *>(node);
     auto objVal = evalExpression(ma->object);
-
-    if (!std::holds_alternative<std::shared_ptr<Instance>>(objVal)) {
-        throw std::runtime_error("Tried to access member on non-object");
-    }
-    auto instance = std::get<std::shared_ptr<Instance>>(objVal);
-
-    auto it = instance->fields.find(ma->member);
-    if (it != instance->fields.end()) {
-        return it->second;
-    }
-
-    auto mit = instance->methods.find(ma->member);
-    if (mit != instance->methods.end()) {
-        return mit->second;
-    }
-
-    throw std::runtime_error("Unknown member: " + ma->member);
+    return getMember(ma->cache, instanceOf(objVal, "access member"), ma->memberSymbol);
 }
 
 case ASTNodeType::METHOD_CALL_EXPR: {
-    auto mc = std::dynamic_pointer_cast<MethodCallExpr>(node);
-    auto objVal = evalExpression(mc->object);
-
-    if (!std::holds_alternative<std::shared_ptr<Instance>>(objVal)) {
-        throw std::runtime_error("Tried to call method on non-object");
-    }
-    auto instance = std::get<std::shared_ptr<Instance>>(objVal);
-
-    auto mit = instance->methods.find(mc->method);
-    if (mit == instance->methods.end()) {
-        throw std::runtime_error("Unknown method: " + mc->method);
+    auto mc = static_cast<MethodCallExpr *>(node);
+    Value objVal;
+    if (isArrayMethod(mc->methodSymbol) && isPlace(mc->object)) {
+        // a.push(v) changes the array where it is stored, an object's own push is still called
+        std::vector<Value> operands;
+        placeOperands(mc->object, operands);
+        const Value *operand = operands.data();
+        objVal = placeSlot(mc->object, operand);
+        if (objVal.isArray()) {
+            objVal = Value(); // don't hold on to it, that would make push copy
+            size_t base = pushArguments(mc->arguments);
+            operand = operands.data();
+            Value result = callArrayMethod(placeSlot(mc->object, operand), mc->methodSymbol,
+                                           frames.stack.data() + base, frames.stack.size() - base);
+            frames.stack.resize(base);
+            return result;
+        }
+    } else {
+        objVal = evalExpression(mc->object);
     }
 
-    std::vector<Value> argVals;
-    for (auto &a : mc->arguments) {
-        argVals.push_back(evalExpression(a));
+    if (objVal.isArray() && isArrayMethod(mc->methodSymbol)) {
+        size_t base = pushArguments(mc->arguments);
+        Value result = callArrayMethod(objVal, mc->methodSymbol, frames.stack.data() + base, frames.stack.size() - base);
+        frames.stack.resize(base);
+        return result;
     }
-
-    return callFunction(mit->second, argVals, instance);
+    FuncDef *method = methodFor(mc, objVal);
+    return callFunction(method, pushArguments(mc->arguments), objVal);
 }
 
 case ASTNodeType::INDEX_EXPR: {
-    auto ie = std::dynamic_pointer_cast<IndexExpr>(node);
+    auto ie = static_cast<IndexExpr *>(node);
+
+    // the target is evaluated before the index. arr[i] on a variable reads the stored array in place
+    // instead of taking another reference to it, when the index can't change what that refers to
+    if (ie->target->type == ASTNodeType::IDENT && isSimpleOperand(ie->index)) {
+        auto e = static_cast<IdentExpr *>(ie->target);
+        const Value &target = frames.read(e->ref, e->name);
+        return indexValue(target, evalExpression(ie->index));
+    }
     auto target = evalExpression(ie->target);
     auto index = evalExpression(ie->index);
-
-    if (!std::holds_alternative<double>(index))
-        throw std::runtime_error("Index must be a number");
-    int i = static_cast<int>(std::get<double>(index));
-
-    if (std::holds_alternative<Array>(target)) {
-        auto &arr = std::get<Array>(target);
-        if (i < 0) i = (int)arr.size() + i; // support negative indexing
-        if (i < 0 || i >= (int)arr.size()) throw std::runtime_error("Array index out of range");
-        return arr[i];
-    } else if (std::holds_alternative<std::string>(target)) {
-        auto &s = std::get<std::string>(target);
-        if (i < 0) i = (int)s.size() + i;
-        if (i < 0 || i >= (int)s.size()) throw std::runtime_error("String index out of range");
-        return std::string(1, s[i]);
-    }
-    throw std::runtime_error("Target is not indexable");
+    return indexValue(target, index);
 }
 
     case ASTNodeType::ARRAY_LITERAL: {
-    auto arrNode = std::dynamic_pointer_cast<ArrayLiteral>(node);
-    Array vals;  // create an Array
+    auto arrNode = static_cast<ArrayLiteral *>(node);
+    std::vector<Value> vals;
+    vals.reserve(arrNode->elements.size());
     for (auto &el : arrNode->elements) {
         vals.push_back(evalExpression(el)); // recursively evaluate each element
     }
-    return Value(vals); // wrap Array in Value
+    return makeArray(std::move(vals)); // wrap the elements in a heap array
 }
 
+    case ASTNodeType::DICT_LITERAL: {
+        auto dictNode = static_cast<DictLiteral *>(node);
+        Value dict = makeDict();
+        for (size_t i = 0; i < dictNode->keys.size(); ++i) {
+            Value key = evalExpression(dictNode->keys[i]);
+            dict.asDict()->set(key, evalExpression(dictNode->values[i]));
+        }
+        return dict;
+    }
+
 
     default:
         throw std::runtime_error("Unknown expression node in evalExpression");
@@ -1,45 +1,112 @@
 #pragma once
 #include "ast.hpp"
-#include <unordered_map>
-#include <variant>
+#include "builtins.hpp"
+#include "value.hpp"
+#include "resolver.hpp"
+#include "output.hpp"
 #include <string>
 #include <vector>
 #include <memory>
 
-class Interpreter {
-public:
-    struct Value;
+// how a statement finished: normally, through a return that unwinds up to callFunction,
+// or through sybau/yeet unwinding up to the innermost loop
+enum class ExecSignal { Normal, Return, Break, Continue };
 
-    using Array = std::vector<Value>;
+// variables as both tree engines (Interpreter and ClosureEngine) keep them: globals by the
+// Resolver's slots, the locals of every active call on one stack, frame after frame
+struct Frames {
+    std::vector<Value> globals;
+    std::vector<Value> stack;
+    size_t base = 0;                    // first slot of the running call
+    const FuncDef *function = nullptr;  // nullptr while running top level code
+    SymbolMap<Value> drips;             // FunctionObj of every drip defined so far, by name
 
-    struct Instance {
-        std::unordered_map<std::string, Value> fields;
-        std::unordered_map<std::string, std::shared_ptr<FuncDef>> methods;
+    // what a call returns to, kept by callFunction while the callee runs
+    struct Caller {
+        size_t base;
+        const FuncDef *function;
     };
 
-    struct Value : std::variant<
-        double,
-        std::string,
-        bool,
-        Array,
-        std::shared_ptr<Instance>,
-        std::shared_ptr<FuncDef> 
-    > {
-        using variant::variant;
-    };
+    //a local that was not assigned yet in this call still sees the global of the same name
+    //(functions never write globals, so this is the value the global had when the call started),
+    //a name no variable holds is the drip of that name
+    const Value &read(const VarRef &ref, const std::string &name) const {
+        if (ref.local) {
+            const Value &v = stack[base + ref.slot];
+            if (!v.isUndefined()) return v;
+            const Value &shadowed = globals[function->localGlobals[ref.slot]];
+            if (shadowed.isUndefined()) return drip(name);
+            return shadowed;
+        }
+        const Value &v = globals[ref.slot];
+        if (v.isUndefined()) return drip(name);
+        return v;
+    }
+    const Value &drip(const std::string &name) const;
+
+    Value &slot(const VarRef &ref) { return ref.local ? stack[base + ref.slot] : globals[ref.slot]; }
+
+    //where a place (see isPlace) starting at variable e is stored
+    Value &placeRoot(const IdentExpr *e);
+
+    //fn called with the arguments on the stack from argBase on: enter checks them and makes
+    //the frame (params, self, then fn's own locals, unset), leave drops it again
+    void checkArguments(const FuncDef *fn, size_t argBase);
+    Caller enter(const FuncDef *fn, size_t argBase, const Value &self);
+    void leave(const Caller &caller, size_t argBase);
+
+    [[noreturn]] static void undefined(const std::string &name);
+};
+
+// the parts of running a node that don't depend on how its operands were evaluated, shared by the tree engines
+
+//the method obj.name(...) runs
+FuncDef *methodFor(MethodCallExpr *mc, const Value &obj);
 
-    void execute(const std::vector<std::shared_ptr<ASTNode>>& statements);
+//f(...) when no drip is named f: the drip or the init of the object the variable f holds, else
+//nullptr and builtin is set to the builtin named f, else an error
+FuncDef *constructorOrBuiltin(const CallExpr *call, const Value &callee, Builtin &builtin);
+
+//pullup Name()
+Value newObject(const SymbolMap<Value> &classes, const NewObjectExpr *no);
+
+//the slot of field obj.name inside a place
+Value &fieldPlace(MemberAccessExpr *ma, const Value &obj);
+
+//loop i = from, to, step with the bounds checked
+struct LoopRange {
+    double from, limit, by;
+    bool more(double i) const { return by > 0 ? i < limit : i > limit; }
+};
+LoopRange loopRange(const Value &from, const Value &to, const Value &step);
+
+class Interpreter : DripCaller {
+public:
+    using Value = ::Value;
+
+    explicit Interpreter(Output &out) : out(out) {}
+    void execute(NodeList<> statements);
 
 private:
-    std::unordered_map<std::string, Value> variables;
-    std::unordered_map<std::string, std::shared_ptr<FuncDef>> functions;
-    std::unordered_map<std::string, std::shared_ptr<ClassDef>> classes;
+    Output &out;                                // where bruh and spill prompts go
+    Resolver resolver;                          // kept for the drips resolved on their first call
+    Frames frames;
+    SymbolMap<FuncDef *> functions;             // drips defined so far, by name
+    SymbolMap<Value> classes;                   // ClassObj of every rizz seen so far
+
+    Value returnValue;                          // set by a return statement, picked up by callFunction
+
+    ExecSignal executeNode(ASTNode *node);
+    ExecSignal executeBlock(NodeList<> statements);
+    ExecSignal executeCountedLoop(CountedLoopStmt *loop);
+    Value evalExpression(ASTNode *node);
 
-    void executeNode(const std::shared_ptr<ASTNode>& node);
-    void executeInput(const std::shared_ptr<InputStmt>& stmt);
-    Value evalExpression(const std::shared_ptr<ASTNode>& node);
+    void placeOperands(ASTNode *place, std::vector<Value> &operands);
+    Value &placeSlot(ASTNode *place, const Value *&operand);
 
-    Value callFunction(const std::shared_ptr<FuncDef>& fn,
-                       const std::vector<Value>& args,
-                       const std::shared_ptr<Instance>& self);
+    size_t pushArguments(NodeList<> args);
+    Value callFunction(FuncDef *fn,
+                       size_t base,
+                       const Value& self);
+    Value call(FuncDef *fn, const Value *args, size_t argc) override;
 };
@@ -1,13 +1,20 @@
 //this is my lexer here my program will go through its first steps where the program will get tokenized for further steps
 #include "lexer.hpp"
-#include <cctype>
+#include <cstring>
 #include <iostream>
-#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define RIZZ_LEXER_SSE2 1
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
 
 //Now this is the contructor this will take src code as string checks the current char at current pos if empty then marks as \0
-Lexer::Lexer(std::string input) : text(std::move(input)), pos(0) {
-    currentChar = text.empty() ? '\0' : text[0];
+Lexer::Lexer(std::string_view input, size_t start) : text(input), pos(start) {
+    currentChar = pos < text.size() ? text[pos] : '\0';
 }
 
 //this function moves the lexer forward by 1 char
@@ -16,36 +23,102 @@ void Lexer::advance() {
     currentChar = (pos < text.size()) ? text[pos] : '\0';
 }
 
+//jumps straight to p, for scanners that find the end of a run themselves
+void Lexer::skipTo(size_t p) {
+    pos = p;
+    currentChar = (pos < text.size()) ? text[pos] : '\0';
+}
+
+//blanks are the whitespace that never makes a token: everything isspace knows except '\n'
+static bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+//digits, and what an identifier starts with ([A-Za-z_]), looked up in one table without going through
+//the locale like isdigit/isalnum do. also fine for bytes >= 0x80, a negative char is UB for those
+enum : unsigned char { CHAR_DIGIT = 1, CHAR_LETTER = 2 };
+struct CharClasses {
+    unsigned char table[256];
+    constexpr CharClasses() : table() {
+        for (int c = 0; c < 256; ++c) {
+            if (c >= '0' && c <= '9') table[c] = CHAR_DIGIT;
+            else if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_') table[c] = CHAR_LETTER;
+        }
+    }
+    bool is(char c, unsigned char classes) const { return table[(unsigned char)c] & classes; }
+};
+constexpr CharClasses CHAR_CLASSES;
+
+static bool isDigit(char c) { return CHAR_CLASSES.is(c, CHAR_DIGIT); }
+static bool isIdentStart(char c) { return CHAR_CLASSES.is(c, CHAR_LETTER); }
+static bool isIdentChar(char c) { return CHAR_CLASSES.is(c, CHAR_DIGIT | CHAR_LETTER); }
+
+#ifdef RIZZ_LEXER_SSE2
+static int lowestSetBit(unsigned mask) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (int)index;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+#endif
+
+//end of the run of blanks starting at from. indentation and generated code have long runs, so
+//with SSE2 they are checked 16 bytes at a time, everything else takes the plain loop
+static size_t skipBlanks(std::string_view text, size_t from) {
+    const char *p = text.data();
+    size_t n = text.size();
+#ifdef RIZZ_LEXER_SSE2
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i cr = _mm_set1_epi8('\r');
+    const __m128i vt = _mm_set1_epi8('\v');
+    const __m128i ff = _mm_set1_epi8('\f');
+    while (from + 16 <= n) {
+        __m128i chunk = _mm_loadu_si128((const __m128i *)(p + from));
+        __m128i blank = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, space), _mm_cmpeq_epi8(chunk, tab)),
+                                     _mm_or_si128(_mm_cmpeq_epi8(chunk, cr),
+                                                  _mm_or_si128(_mm_cmpeq_epi8(chunk, vt), _mm_cmpeq_epi8(chunk, ff))));
+        unsigned notBlank = ~(unsigned)_mm_movemask_epi8(blank) & 0xFFFF;
+        if (notBlank) return from + lowestSetBit(notBlank);
+        from += 16;
+    }
+#endif
+    while (from < n && isBlank(p[from])) from++;
+    return from;
+}
+
+//first c at or after from, or the end of the text. memchr is vectorized by every libc we build with
+static size_t findChar(std::string_view text, size_t from, char c) {
+    if (from >= text.size()) return text.size();
+    const void *hit = std::memchr(text.data() + from, c, text.size() - from);
+    return hit ? (size_t)((const char *)hit - text.data()) : text.size();
+}
+
 //this is to skip whitespaces so that these spaces dont produce tokens , but keeps newLine in the game
 void Lexer::skipWhitespace() {
-    while (std::isspace(currentChar) && currentChar != '\0' && currentChar != '\n')
-        advance();
+    skipTo(skipBlanks(text, pos));
 }
 
 //this reads number from the i/p and collects integer from it , if it sees '.' in it then switches to float and collects the decimal digits based on it.
 Token Lexer::number() {
-    std::string result;
+    size_t start = pos;
     //taking it as integer in start
     bool isFloat = false;
 
     // integer part
-    while (std::isdigit(currentChar)) {
-        result += currentChar;
-        advance();
-    }
+    while (isDigit(currentChar)) advance();
 
     // check for decimal point
     if (currentChar == '.') {
         isFloat = true;
-        result += currentChar;
         advance();
-
-        while (std::isdigit(currentChar)) {
-            result += currentChar;
-            advance();
-        }
+        while (isDigit(currentChar)) advance();
     }
 
+    std::string_view result = text.substr(start, pos - start);
     if (isFloat) {
         return {TokenType::FLOAT, result};
     } else {
@@ -53,60 +126,106 @@ Token Lexer::number() {
     }
 }
 
+namespace {
+
+struct Keyword {
+    std::string_view text;
+    TokenType type;
+    CondType condType;
+};
+
+constexpr Keyword KEYWORDS[] = {
+    {"bruh", TokenType::PRINT, CondType::IF},
+    {"spill", TokenType::INPUT, CondType::IF},
+    {"bet", TokenType::COND, CondType::IF},
+    {"forReal", TokenType::COND, CondType::ELSE},
+    {"noFam", TokenType::COND, CondType::ELSEIF},
+    {"drip", TokenType::FUNC, CondType::IF},
+    {"finna", TokenType::FUNCEND, CondType::IF},
+    {"yikes", TokenType::CONDEND, CondType::IF},
+    {"return", TokenType::RETURN, CondType::IF},
+    {"rizz", TokenType::CLASS, CondType::IF},
+    {"goner", TokenType::CLASSEND, CondType::IF},
+    {"loop", TokenType::LOOP, CondType::IF},
+    {"periodt", TokenType::LOOPEND, CondType::IF},
+    {"no_cap", TokenType::TRUE, CondType::IF},
+    {"cap", TokenType::FALSE, CondType::IF},
+    {"yeet", TokenType::CONTINUE, CondType::IF},
+    {"sybau", TokenType::BREAK, CondType::IF},
+    {"pullup", TokenType::OBJECT, CondType::IF},
+};
+
+//perfect hash of the keywords above: length, first and last char already tell all of them apart,
+//so any identifier needs one table probe and one compare. the static_assert below catches a
+//collision if a new keyword is added, then pick other multipliers
+constexpr size_t KEYWORD_SLOTS = 32;
+constexpr size_t keywordHash(std::string_view s) {
+    return (5 * s.size() + 2 * (unsigned char)s.front() + (unsigned char)s.back()) & (KEYWORD_SLOTS - 1);
+}
+
+struct KeywordTable {
+    Keyword slots[KEYWORD_SLOTS];
+    bool collision;
+};
+
+constexpr KeywordTable buildKeywordTable() {
+    KeywordTable table{};
+    for (const Keyword &k : KEYWORDS) {
+        Keyword &slot = table.slots[keywordHash(k.text)];
+        if (!slot.text.empty()) table.collision = true;
+        slot = k;
+    }
+    return table;
+}
+
+constexpr KeywordTable KEYWORD_TABLE = buildKeywordTable();
+static_assert(!KEYWORD_TABLE.collision, "two keywords share a hash slot");
+
+}
+
 //this reads variables and functions then links them to their resp keywords "bruh" -> print and more like this , if no keyword matches then its generic IDENT
 Token Lexer::identifier() {
-    std::string result;
-    while (std::isalnum(currentChar) || currentChar == '_') {
-        result += currentChar;
-        advance();
-    }
+    size_t start = pos;
+    size_t end = pos;
+    while (end < text.size() && isIdentChar(text[end])) end++;
+    skipTo(end);
+    std::string_view result = text.substr(start, end - start);
 
-    if (result == "bruh") return {TokenType::PRINT, result};
-    if (result == "spill") return {TokenType::INPUT , result};
-    if (result == "bet") return {TokenType::COND, result , CondType::IF};
-    if (result == "forReal") return {TokenType::COND, result , CondType::ELSE};
-    if (result == "noFam") return {TokenType::COND,result ,CondType::ELSEIF};
-    if (result == "drip") return {TokenType::FUNC, result};
-    if (result == "finna") return {TokenType::FUNCEND , result};
-    if (result == "yikes") return {TokenType::CONDEND , result };
-    if (result == "return") return {TokenType::RETURN , result};
-    if (result == "rizz") return {TokenType::CLASS, result};
-    if (result == "goner") return {TokenType::CLASSEND , result};
-    if (result == "loop") return {TokenType::LOOP, result};
-    if (result == "no_cap") return {TokenType::TRUE, result};
-    if (result == "cap") return {TokenType::FALSE, result};
-    if (result == "yeet") return {TokenType::CONTINUE, result};
-    if (result == "sybau") return {TokenType::BREAK, result};
-    if (result == "pullup") return {TokenType::OBJECT , result};
-    
+    const Keyword &k = KEYWORD_TABLE.slots[keywordHash(result)];
+    if (k.text == result) return {k.type, result, k.condType};
     return {TokenType::IDENT, result};
 }
 
 //handles string literals , it skips the opening an closing qoutes and taes up the string 
 Token Lexer::stringLiteral() {
-    advance(); // skip opening "
-    std::string result;
-    while (currentChar != '"' && currentChar != '\0') {
-        result += currentChar;
-        advance();
-    }
-    advance(); // skip closing "
+    size_t start = pos + 1; // skip opening "
+    size_t end = findChar(text, start, '"');
+    std::string_view result = text.substr(start, end - start);
+    skipTo(end + 1); // skip closing "
     return {TokenType::STRING, result};
 }
 
-//this is the main part in the lexer, it detects space and newlines and skips them also this detects number alpha and symbols
+//every token remembers where it started, so the parser can come back to a range of the source later
 Token Lexer::getNextToken() {
+    Token tok = scanToken();
+    tok.offset = tokenStart;
+    return tok;
+}
+
+//this is the main part in the lexer, it detects space and newlines and skips them also this detects number alpha and symbols
+Token Lexer::scanToken() {
     while (currentChar != '\0') {
-        if (std::isspace(currentChar)) {
-            if (currentChar == '\n') {
-                advance();
-                return {TokenType::NEWLINE, "\\n"};
-            }
+        tokenStart = pos;
+        if (currentChar == '\n') {
+            advance();
+            return {TokenType::NEWLINE, "\\n"};
+        }
+        if (isBlank(currentChar)) {
             skipWhitespace();
             continue;
         }
-        if (std::isdigit(currentChar)) return number();
-        if (std::isalpha(currentChar) || currentChar == '_') return identifier();
+        if (isDigit(currentChar)) return number();
+        if (isIdentStart(currentChar)) return identifier();
         if (currentChar == '"') return stringLiteral();
         if (currentChar == '=') {
             advance();
@@ -130,13 +249,10 @@ Token Lexer::getNextToken() {
         }
         if (currentChar == '/') {
             advance(); 
-            if (currentChar == '/') { std::string comment = "//"; 
-                while( currentChar != '\n' && currentChar != '\0' ) {
-                    comment += currentChar;
-                    advance();
-                }
+            if (currentChar == '/') {
+                skipTo(findChar(text, pos, '\n')); // the newline itself still becomes a token
                 continue;
-                return {TokenType::COMMENT, comment};}
+            }
             return {TokenType::DIV, "/"}; 
         }
         if (currentChar == ':') { advance(); return {TokenType::COLON, ":"}; }
@@ -148,6 +264,8 @@ Token Lexer::getNextToken() {
         if (currentChar == ')') { advance(); return {TokenType::RPAREN, ")"}; }
         if (currentChar == '[') { advance(); return {TokenType::LBRACKET, "["}; }
         if (currentChar == ']') { advance(); return {TokenType::RBRACKET, "]"}; }
+        if (currentChar == '{') { advance(); return {TokenType::LBRACE, "{"}; }
+        if (currentChar == '}') { advance(); return {TokenType::RBRACE, "}"}; }
         if (currentChar == ';') { advance(); return {TokenType::SEMI, ";"}; }
         if (currentChar == ',') { advance(); return {TokenType::COMMA, ","}; }
         if (currentChar == '.') { advance(); return {TokenType::DOT, "."}; }
@@ -155,16 +273,7 @@ Token Lexer::getNextToken() {
         std::cerr << "Unexpected char: " << currentChar << "\n";
         advance();
     }
+    tokenStart = pos;
     return {TokenType::ENDOFFILE, ""};
 
 }
-//this is called every time until the EOF , then stores all the tokens in vector and later return them
-std::vector<Token> Lexer::tokenize() {
-    std::vector<Token> tokens;
-    while (true) {
-        Token tok = getNextToken();
-        tokens.push_back(tok);
-        if (tok.type == TokenType::ENDOFFILE) break;
-    }
-    return tokens;
-}
\ No newline at end of file
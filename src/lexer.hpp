@@ -1,21 +1,24 @@
 #pragma once
 #include "token.hpp"
 #include <string>
-#include <vector>
+#include <string_view>
 //this is my lexer header file this will contain the functions declaration for the lexer 
 class Lexer {
-    std::string text;
+    std::string_view text;   // the source, has to outlive the lexer and every token it hands out
     size_t pos;
     char currentChar;
+    size_t tokenStart = 0;   // offset of the token being scanned
 
 public:
-    Lexer(std::string input);
+    Lexer(std::string_view input, size_t start = 0);   // start: offset of the first char to lex
     Token getNextToken();
-    std::vector<Token> tokenize();
+    std::string_view source() const { return text; }
 
 private:
     void advance();
+    void skipTo(size_t p);
     void skipWhitespace();
+    Token scanToken();
     Token number();
     Token identifier();
     Token stringLiteral();
@@ -1,38 +1,82 @@
+#include <chrono>
 #include <iostream>
-#include <fstream>
-#include <sstream>
 #include "lexer.hpp"
 #include "parser.hpp"
 #include "interpreter.hpp"
+#include "compiler.hpp"
+#include "vm.hpp"
+#include "closure.hpp"
+#include "source.hpp"
+#include "cache.hpp"
+#include "optimizer.hpp"
+#include "dump.hpp"
+#include "output.hpp"
 
-std::string runCode(const std::string &code) {
-    try {
-        Lexer lexer(code);
-        auto tokens = lexer.tokenize();
-
-        Parser parser(tokens);
-        auto ast = parser.parse();
-
-        Interpreter interpreter;
+enum class Engine { AST, VM, CLOSURE };
 
-        // Capture output printed by interpreter
-        std::ostringstream outputCapture;
-        std::streambuf* oldCout = std::cout.rdbuf(outputCapture.rdbuf());
+static Script parseCode(std::string_view code, Engine engine) {
+    Lexer lexer(code);
+    Parser parser(lexer);   // pulls tokens from the lexer as it goes
+    parser.deferBodies = engine != Engine::VM;   // the compiler needs every body anyway
+    Script script = parser.parse();
+    optimize(script);
+    return script;
+}
 
-        interpreter.execute(ast);
+//runs an already parsed script, printing to out. A runtime error is reported after whatever the
+//script printed before it.
+static void runScript(const Script &script, Engine engine, Output &out) {
+    try {
+        if (engine == Engine::VM) {
+            Compiler compiler;
+            Program program = compiler.compile(script.statements);
+            VM vm(out);
+            vm.run(program);
+        } else if (engine == Engine::CLOSURE) {
+            ClosureEngine closures(out);
+            closures.execute(script.statements);
+        } else {
+            Interpreter interpreter(out);
+            interpreter.execute(script.statements);
+        }
+    } catch (const std::exception &e) {
+        out.write("Error: ");
+        out.write(e.what());
+    }
+    out.flush();
+}
 
-        std::cout.rdbuf(oldCout); // restore cout
-        return outputCapture.str();
+//runs code and returns what it printed, for callers that want the output as a string (the web
+//playground). code only has to stay valid for the duration of the call, nothing keeps pointing
+//into it afterwards
+std::string runCode(std::string_view code, Engine engine = Engine::AST) {
+    Script script;   // keeps the AST alive until the engine is done with it
+    try {
+        script = parseCode(code, engine);
     } catch (const std::exception &e) {
         return std::string("Error: ") + e.what();
     }
+    std::string printed;
+    Output out(printed);
+    runScript(script, engine, out);
+    return printed;
+}
+
+static const char *cacheResultName(CacheResult r) {
+    switch (r) {
+    case CacheResult::Hit: return "hit";
+    case CacheResult::Missing: return "miss (no cache file)";
+    case CacheResult::Stale: return "miss (stale)";
+    case CacheResult::Corrupt: return "miss (corrupt)";
+    }
+    return "miss";
 }
 
 // ✅ Expose to JavaScript
 extern "C" {
     const char* runCodeC(const char* code) {
         static std::string result;
-        result = runCode(std::string(code));
+        result = runCode(code);
         return result.c_str();
     }
 }
@@ -40,25 +84,75 @@ extern "C" {
 int main(int argc, char* argv[])
 {
     if (argc > 1 && std::string(argv[1]) == "--version") {
-        std::cout << "RizzLang v1.0.12" << std::endl;
+        std::cout << "RizzLang v" RIZZ_VERSION << std::endl;
         return 0;
     }
-    if (argc < 2) {
-        std::cerr << "Usage: " << argv[0] << " <source-file>\n";
+
+    Engine engine = Engine::AST;
+    bool useCache = true;
+    bool cacheStats = false;
+    bool dumpOptimized = false;
+    std::string filename;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--engine=ast") engine = Engine::AST;
+        else if (arg == "--engine=vm") engine = Engine::VM;
+        else if (arg == "--engine=closure") engine = Engine::CLOSURE;
+        else if (arg.rfind("--engine=", 0) == 0) {
+            std::cerr << "Unknown engine: " << arg.substr(9) << " (expected ast, vm or closure)\n";
+            return 1;
+        }
+        else if (arg == "--no-cache") useCache = false;
+        else if (arg == "--cache-stats") cacheStats = true;
+        else if (arg == "--dump-optimized") dumpOptimized = true;
+        else filename = arg;
+    }
+    if (filename.empty()) {
+        std::cerr << "Usage: " << argv[0] << " [--engine=ast|vm|closure] [--no-cache] [--cache-stats] [--dump-optimized] <source-file>\n";
         return 1;
     }
 
-    std::string filename = argv[1];
-    std::ifstream file(filename);
-    if (!file.is_open()) {
+    SourceFile source; // mapped, not copied
+    if (!source.open(filename)) {
         std::cerr << "Error: Could not open file " << filename << "\n";
         return 1;
     }
 
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    std::string code = buffer.str();
+    //a cache hit skips the lexer and parser, the source is only hashed
+    auto start = std::chrono::steady_clock::now();
+    std::string cachePath = cachePathFor(filename);
+    uint64_t hash = sourceHash(source.text());
+    Script script;
+    CacheResult cached = useCache ? loadCachedScript(cachePath, source.text(), hash, script) : CacheResult::Missing;
+    if (cached != CacheResult::Hit) {
+        try {
+            script = parseCode(source.text(), engine);
+        } catch (const std::exception &e) {
+            std::cout << "Error: " << e.what();
+            return 0;
+        }
+        if (useCache && !saveCachedScript(cachePath, hash, script) && cacheStats)
+            std::cerr << "[cache] could not write " << cachePath << "\n";
+    }
+    auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start);
+
+    if (cacheStats) {
+        std::cerr << "[cache] " << (useCache ? cacheResultName(cached) : "disabled")
+                  << ", " << (cached == CacheResult::Hit ? "loaded" : "parsed") << " in " << elapsed.count()
+                  << " ms, ast " << script.arena->bytesUsed() << " bytes\n";
+    }
+
+    if (dumpOptimized) { // print the optimized script instead of running it
+        try {
+            dumpScript(std::cout, script.statements);
+        } catch (const std::exception &e) {
+            std::cout << "Error: " << e.what();
+        }
+        return 0;
+    }
 
-    std::cout << runCode(code); // reuse runCode
+    std::cout.flush(); // nothing written through cout may end up after the script's output
+    Output out(1);     // straight to stdout, nothing is held back until the script ends
+    runScript(script, engine, out);
     return 0;
 }
@@ -0,0 +1,122 @@
+// src/number.cpp
+//std::to_chars / from_chars where the standard library has them for doubles (shortest round trip
+//formatting, no locale, no exceptions). Older libc++ (macOS before 13.3, wasm toolchains) lacks
+//one or both, there the same text is produced from printf/strtod.
+#include "number.hpp"
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__cpp_lib_to_chars)
+#define RIZZ_TO_CHARS 1
+#define RIZZ_FROM_CHARS 1
+#elif defined(_LIBCPP_VERSION) && defined(_LIBCPP_AVAILABILITY_HAS_TO_CHARS_FLOATING_POINT)
+#if _LIBCPP_AVAILABILITY_HAS_TO_CHARS_FLOATING_POINT
+#define RIZZ_TO_CHARS 1
+#endif
+#endif
+
+#ifndef RIZZ_TO_CHARS
+//what to_chars(buf, d) writes, built from the fewest printf digits that read back as d: fixed or
+//scientific notation, whichever is shorter, fixed on a tie
+static size_t shortestFromPrintf(char *buf, double d) {
+    char sci[NUMBER_CHARS];
+    for (int precision = 1; precision <= 17; ++precision) {
+        std::snprintf(sci, sizeof sci, "%.*e", precision - 1, d);
+        if (precision == 17 || std::strtod(sci, nullptr) == d) break;
+    }
+    // sci is [-]d[.ddd]e±xx: split it into sign, digits and exponent
+    const char *p = sci;
+    bool negative = *p == '-';
+    if (negative) ++p;
+    char digits[NUMBER_CHARS];
+    int n = 0;
+    for (; *p != 'e'; ++p)
+        if (*p != '.') digits[n++] = *p;
+    while (n > 1 && digits[n - 1] == '0') --n;
+    int exponent = std::atoi(p + 1);
+
+    char fixed[NUMBER_CHARS * 12]; // room for the largest fixed form (1e308)
+    size_t f = 0;
+    if (exponent >= n - 1) {
+        // a whole number: to_chars spells out its exact digits, not the shortest ones padded with zeros
+        f = (size_t)std::snprintf(fixed, sizeof fixed, "%.0f", d);
+    } else if (exponent >= 0) {
+        if (negative) fixed[f++] = '-';
+        for (int i = 0; i < n; ++i) {
+            fixed[f++] = digits[i];
+            if (i == exponent) fixed[f++] = '.';
+        }
+    } else {
+        if (negative) fixed[f++] = '-';
+        fixed[f++] = '0';
+        fixed[f++] = '.';
+        for (int i = -1; i > exponent; --i) fixed[f++] = '0';
+        for (int i = 0; i < n; ++i) fixed[f++] = digits[i];
+    }
+
+    size_t s = 0;
+    if (negative) buf[s++] = '-';
+    buf[s++] = digits[0];
+    if (n > 1) {
+        buf[s++] = '.';
+        for (int i = 1; i < n; ++i) buf[s++] = digits[i];
+    }
+    s += (size_t)std::snprintf(buf + s, NUMBER_CHARS - s, "e%c%02d", exponent < 0 ? '-' : '+',
+                               exponent < 0 ? -exponent : exponent);
+    if (f <= s) {
+        std::memcpy(buf, fixed, f);
+        return f;
+    }
+    return s;
+}
+#endif
+
+size_t formatNumber(char *buf, double d) {
+    // spelled out here so both ways agree, and every nan prints the same whatever its sign bit
+    if (std::isnan(d)) {
+        std::memcpy(buf, "nan", 3);
+        return 3;
+    }
+    if (std::isinf(d)) {
+        size_t n = d < 0 ? 4 : 3;
+        std::memcpy(buf, d < 0 ? "-inf" : "inf", n);
+        return n;
+    }
+#ifdef RIZZ_TO_CHARS
+    return (size_t)(std::to_chars(buf, buf + NUMBER_CHARS, d).ptr - buf);
+#else
+    return shortestFromPrintf(buf, d);
+#endif
+}
+
+bool parseNumber(std::string_view text, double &out) {
+    if (!text.empty() && text[0] == '+') {
+        text.remove_prefix(1); // from_chars only takes a '-'
+        if (!text.empty() && text[0] == '-') return false;
+    }
+    if (text.empty() || std::isspace((unsigned char)text[0])) return false; // strtod would skip it
+    double d;
+#ifdef RIZZ_FROM_CHARS
+    const char *end = text.data() + text.size();
+    auto result = std::from_chars(text.data(), end, d);
+    if (result.ptr != end) return false;
+    if (result.ec == std::errc::result_out_of_range) {
+        // past what a double holds: inf or 0 like strtod, the lexer and spill shouldn't fail on it
+        d = std::strtod(std::string(text).c_str(), nullptr);
+    } else if (result.ec != std::errc()) {
+        return false;
+    }
+#else
+    if (text.find_first_of("xXpP") != std::string_view::npos) return false; // strtod also reads hex
+    std::string s(text); // strtod needs the terminator
+    char *stop;
+    d = std::strtod(s.c_str(), &stop);
+    if (stop != s.c_str() + s.size()) return false;
+#endif
+    out = d;
+    return true;
+}
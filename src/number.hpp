@@ -0,0 +1,24 @@
+// src/number.hpp
+//numbers to text and back, for everything in the language that does it: bruh, + with a string,
+//spill, number literals and --dump-optimized. Formatting gives the shortest text that reads back
+//as the very same double (2.7, 0.30000000000000004, 1e+21), so printed numbers are exact and come
+//out the same on every platform instead of depending on a precision setting.
+#pragma once
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+//room formatNumber needs for any double, sign and exponent included
+constexpr size_t NUMBER_CHARS = 32;
+
+//writes d into buf and returns how many chars it took, no terminator
+size_t formatNumber(char *buf, double d);
+
+inline std::string numberToString(double d) {
+    char buf[NUMBER_CHARS];
+    return std::string(buf, formatNumber(buf, d));
+}
+
+//text as a number: decimal, optionally signed, with a fraction and exponent, or inf / nan.
+//All of text has to be the number, false otherwise (out is left alone then).
+bool parseNumber(std::string_view text, double &out);
@@ -0,0 +1,265 @@
+// src/optimizer.cpp
+//folding follows the engines to the letter: the same double math, concatValues for everything
+//else, and whatever would throw is left alone so the error still happens at runtime
+#include "optimizer.hpp"
+#include <cmath>
+#include <stdexcept>
+
+static bool isLiteral(const ASTNode *node) {
+    return node->type == ASTNodeType::NUMBER || node->type == ASTNodeType::STRING ||
+           node->type == ASTNodeType::BOOL;
+}
+
+static Value literalValue(const ASTNode *node) {
+    switch (node->type) {
+    case ASTNodeType::NUMBER:
+        return static_cast<const NumberExpr *>(node)->value;
+    case ASTNodeType::STRING:
+        return static_cast<const StringExpr *>(node)->value;
+    default:
+        return static_cast<const BoolExpr *>(node)->value;
+    }
+}
+
+//true when an expression statement can be dropped: evaluating it has no effect and can't fail
+static bool isPure(const ASTNode *node) {
+    if (isLiteral(node)) return true;
+    if (node->type != ASTNodeType::ARRAY_LITERAL) return false;
+    for (auto el : static_cast<const ArrayLiteral *>(node)->elements)
+        if (!isPure(el)) return false;
+    return true;
+}
+
+//what evalExpression would give for L op R, false when it would throw
+static bool foldBinary(const std::string &op, const Value &L, const Value &R, Value &out) {
+    if (L.isNumber() && R.isNumber()) {
+        double l = L.asNumber();
+        double r = R.asNumber();
+        if (op == "+") out = l + r;
+        else if (op == "-") out = l - r;
+        else if (op == "*") out = l * r;
+        else if (op == "/") out = l / r;
+        else if (op == "%") out = std::fmod(l, r);
+        else if (op == ">") out = l > r;
+        else if (op == "<") out = l < r;
+        else if (op == ">=") out = l >= r;
+        else if (op == "<=") out = l <= r;
+        else if (op == "==") out = l == r;
+        else if (op == "!=") out = l != r;
+        else return false;
+        return true;
+    }
+    try {
+        out = concatValues(op, L, R);
+        return true;
+    } catch (const std::runtime_error &) {
+        return false;
+    }
+}
+
+static bool foldUnary(const std::string &op, const Value &v, Value &out) {
+    if (op == "!") {
+        if (v.isBool()) out = !v.asBool();
+        else if (v.isNumber()) out = v.asNumber() == 0.0;
+        else return false;
+        return true;
+    }
+    if (op == "-" && v.isNumber()) {
+        out = -v.asNumber();
+        return true;
+    }
+    return false;
+}
+
+ASTNode *Optimizer::literal(const Value &v) {
+    if (v.isNumber()) return arena.make<NumberExpr>(v.asNumber());
+    if (v.isBool()) return arena.make<BoolExpr>(v.asBool());
+    return arena.make<StringExpr>(v.asString());
+}
+
+NodeList<> Optimizer::block(NodeList<> statements) {
+    std::vector<ASTNode *> out;
+    out.reserve(statements.size());
+    for (auto stmt : statements) {
+        if (!stmt) continue;
+        statement(stmt, out);
+        // whatever follows a return, sybau or yeet in the same block never runs
+        if (!out.empty()) {
+            ASTNodeType last = out.back()->type;
+            if (last == ASTNodeType::RETURN_STMT || last == ASTNodeType::BREAK_STMT ||
+                last == ASTNodeType::CONTINUE_STMT)
+                break;
+        }
+    }
+    return makeList(arena, out);
+}
+
+void Optimizer::function(FuncDef *fn) {
+    if (!fn->deferred) fn->body = block(fn->body);
+}
+
+void Optimizer::statement(ASTNode *node, std::vector<ASTNode *> &out) {
+    switch (node->type) {
+    case ASTNodeType::PRINT_STMT: {
+        auto stmt = static_cast<PrintStmt *>(node);
+        stmt->value = expression(stmt->value);
+        break;
+    }
+    case ASTNodeType::ASSIGN_STMT: {
+        auto stmt = static_cast<AssignStmt *>(node);
+        stmt->value = expression(stmt->value);
+        break;
+    }
+    case ASTNodeType::EXPR_STMT: {
+        auto stmt = static_cast<ExprStmt *>(node);
+        stmt->expr = expression(stmt->expr);
+        if (isPure(stmt->expr)) return;
+        break;
+    }
+    case ASTNodeType::MEMBER_ASSIGN_STMT: {
+        auto stmt = static_cast<MemberAssignStmt *>(node);
+        stmt->object = expression(stmt->object);
+        stmt->value = expression(stmt->value);
+        break;
+    }
+    case ASTNodeType::INDEX_ASSIGN_STMT: {
+        auto stmt = static_cast<IndexAssignStmt *>(node);
+        stmt->target = expression(stmt->target);
+        stmt->index = expression(stmt->index);
+        stmt->value = expression(stmt->value);
+        break;
+    }
+    case ASTNodeType::RETURN_STMT: {
+        auto stmt = static_cast<ReturnStmt *>(node);
+        if (stmt->value) stmt->value = expression(stmt->value);
+        break;
+    }
+    case ASTNodeType::IF_STMT: {
+        // branches whose condition is a false literal go away, a true literal makes its branch
+        // the last one (it catches everything that gets that far)
+        IfStmt *first = nullptr;
+        IfStmt *last = nullptr;
+        for (auto branch = static_cast<IfStmt *>(node); branch;) {
+            IfStmt *next = branch->next;
+            if (branch->condition) {
+                branch->condition = expression(branch->condition);
+                if (isLiteral(branch->condition)) {
+                    if (!isTruthy(literalValue(branch->condition))) {
+                        branch = next;
+                        continue;
+                    }
+                    branch->condition = nullptr;
+                    next = nullptr;
+                }
+            }
+            branch->thenBranch = block(branch->thenBranch);
+            branch->next = nullptr;
+            if (last) last->next = branch;
+            else first = branch;
+            last = branch;
+            if (!branch->condition) break;
+            branch = next;
+        }
+        if (!first) return;
+        if (!first->condition) {
+            // always taken: its statements run in place of the bet
+            for (auto s : first->thenBranch) out.push_back(s);
+            return;
+        }
+        node = first;
+        break;
+    }
+    case ASTNodeType::LOOP_STMT: {
+        auto loop = static_cast<LoopStmt *>(node);
+        loop->condition = expression(loop->condition);
+        if (isLiteral(loop->condition) && !isTruthy(literalValue(loop->condition))) return;
+        loop->body = block(loop->body);
+        break;
+    }
+    case ASTNodeType::COUNTED_LOOP_STMT: {
+        auto loop = static_cast<CountedLoopStmt *>(node);
+        loop->from = expression(loop->from);
+        loop->to = expression(loop->to);
+        if (loop->step) loop->step = expression(loop->step);
+        loop->body = block(loop->body);
+        break;
+    }
+    case ASTNodeType::FUNC_DEF:
+        function(static_cast<FuncDef *>(node));
+        break;
+    case ASTNodeType::CLASS_DEF:
+        for (auto m : static_cast<ClassDef *>(node)->methods) function(m);
+        break;
+    default:
+        break;
+    }
+    out.push_back(node);
+}
+
+ASTNode *Optimizer::expression(ASTNode *node) {
+    switch (node->type) {
+    case ASTNodeType::BINARY_EXPR: {
+        auto be = static_cast<BinaryExpr *>(node);
+        be->left = expression(be->left);
+        be->right = expression(be->right);
+        Value folded;
+        if (isLiteral(be->left) && isLiteral(be->right) &&
+            foldBinary(be->op, literalValue(be->left), literalValue(be->right), folded))
+            return literal(folded);
+        return node;
+    }
+    case ASTNodeType::UNARY_EXPR: {
+        auto ue = static_cast<UnaryExpr *>(node);
+        ue->operand = expression(ue->operand);
+        Value folded;
+        if (isLiteral(ue->operand) && foldUnary(ue->op, literalValue(ue->operand), folded))
+            return literal(folded);
+        return node;
+    }
+    case ASTNodeType::INDEX_EXPR: {
+        auto ie = static_cast<IndexExpr *>(node);
+        ie->target = expression(ie->target);
+        ie->index = expression(ie->index);
+        if (ie->target->type == ASTNodeType::STRING && isLiteral(ie->index)) {
+            try {
+                return literal(indexValue(literalValue(ie->target), literalValue(ie->index)));
+            } catch (const std::runtime_error &) {
+                // out of range, reported when it runs
+            }
+        }
+        return node;
+    }
+    case ASTNodeType::ARRAY_LITERAL:
+        for (auto &el : static_cast<ArrayLiteral *>(node)->elements) el = expression(el);
+        return node;
+    case ASTNodeType::DICT_LITERAL: {
+        auto dict = static_cast<DictLiteral *>(node);
+        for (auto &k : dict->keys) k = expression(k);
+        for (auto &v : dict->values) v = expression(v);
+        return node;
+    }
+    case ASTNodeType::CALL_EXPR:
+        for (auto &a : static_cast<CallExpr *>(node)->args) a = expression(a);
+        return node;
+    case ASTNodeType::NEW_OBJECT_EXPR:
+        for (auto &a : static_cast<NewObjectExpr *>(node)->args) a = expression(a);
+        return node;
+    case ASTNodeType::METHOD_CALL_EXPR: {
+        auto mc = static_cast<MethodCallExpr *>(node);
+        mc->object = expression(mc->object);
+        for (auto &a : mc->arguments) a = expression(a);
+        return node;
+    }
+    case ASTNodeType::MEMBER_ACCESS_EXPR: {
+        auto ma = static_cast<MemberAccessExpr *>(node);
+        ma->object = expression(ma->object);
+        return node;
+    }
+    default:
+        return node;
+    }
+}
+
+void optimize(Script &script) {
+    script.statements = Optimizer(*script.arena).block(script.statements);
+}
@@ -0,0 +1,26 @@
+// src/optimizer.hpp
+//runs on the AST between the parser and the engines: operators over literals become literals,
+//bet/noFam branches with a constant condition are decided once here, and statements that can
+//never do anything are dropped, so none of that is redone every time the code runs
+#pragma once
+#include "ast.hpp"
+#include <vector>
+
+class Optimizer {
+public:
+    explicit Optimizer(AstArena &a) : arena(a) {}
+
+    //the optimized statements, nodes are changed in place and new ones go into the arena
+    NodeList<> block(NodeList<> statements);
+
+private:
+    AstArena &arena;
+
+    void statement(ASTNode *node, std::vector<ASTNode *> &out);
+    ASTNode *expression(ASTNode *node);
+    void function(FuncDef *fn);
+    ASTNode *literal(const Value &v);
+};
+
+//optimizes the whole script, drips still deferred are optimized once they are parsed
+void optimize(Script &script);
@@ -0,0 +1,40 @@
+// src/output.cpp
+#include "output.hpp"
+#include <cerrno>
+
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+Output::Output(int fd) : fd(fd), buffer(new char[BUFFER_SIZE]) {}
+
+Output::Output(std::string &capture) : capture(&capture), buffer(new char[BUFFER_SIZE]) {}
+
+void Output::flush() {
+    if (used == 0) return;
+    size_t n = used;
+    used = 0;
+    writeOut(buffer.get(), n);
+}
+
+void Output::writeOut(const char *s, size_t n) {
+    if (capture) {
+        capture->append(s, n);
+        return;
+    }
+    while (n > 0) {
+#if defined(_WIN32)
+        int written = _write(fd, s, (unsigned)(n < 0x40000000 ? n : 0x40000000));
+#else
+        ssize_t written = ::write(fd, s, n);
+#endif
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return; // stdout went away (closed pipe...), nothing left to print to
+        }
+        s += written;
+        n -= (size_t)written;
+    }
+}
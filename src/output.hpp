@@ -0,0 +1,44 @@
+// src/output.hpp
+//where a running script's bruh output and spill prompts go. Writes collect in a large buffer that
+//is handed over in one piece when it fills up, before spill reads a line and when the script ends,
+//so printing a million lines is a handful of writes instead of a flush per line.
+#pragma once
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+
+class Output {
+public:
+    static constexpr size_t BUFFER_SIZE = 1 << 16;
+
+    explicit Output(int fd);                // streams to a file descriptor, 1 for stdout
+    explicit Output(std::string &capture);  // appends everything to capture instead
+    Output(const Output &) = delete;
+    Output &operator=(const Output &) = delete;
+    ~Output() { flush(); }
+
+    void write(const char *s, size_t n) {
+        if (n > BUFFER_SIZE - used) {
+            flush();
+            if (n >= BUFFER_SIZE) return writeOut(s, n); // too big to be worth copying
+        }
+        std::memcpy(buffer.get() + used, s, n);
+        used += n;
+    }
+    void write(std::string_view s) { write(s.data(), s.size()); }
+    void put(char c) {
+        if (used == BUFFER_SIZE) flush();
+        buffer[used++] = c;
+    }
+    void flush();
+
+private:
+    int fd = -1;
+    std::string *capture = nullptr;
+    std::unique_ptr<char[]> buffer;
+    size_t used = 0;
+
+    void writeOut(const char *s, size_t n);
+};
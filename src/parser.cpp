@@ -1,11 +1,22 @@
 // src/parser.cpp
 #include "parser.hpp"
+#include "number.hpp"
+#include "optimizer.hpp"
 #include <stdexcept>
 #include <iostream>
 
-std::vector<std::shared_ptr<ASTNode>> Parser::parse()
+void Parser::growLookahead()
 {
-    std::vector<std::shared_ptr<ASTNode>> program;
+    std::vector<Token> bigger(lookahead.size() * 2);
+    for (size_t i = 0; i < count; ++i)
+        bigger[i] = lookahead[(head + i) & (lookahead.size() - 1)];
+    lookahead = std::move(bigger);
+    head = 0;
+}
+
+Script Parser::parse()
+{
+    std::vector<ASTNode *> program;
     while (!isAtEnd())
     {
         if (peek().type == TokenType::NEWLINE || peek().type == TokenType::COMMENT)
@@ -27,10 +38,11 @@ std::vector<std::shared_ptr<ASTNode>> Parser::parse()
         if (stmt)
             program.push_back(stmt);
     }
-    return program;
+    script.statements = list(program);
+    return std::move(script);
 }
 
-std::shared_ptr<ASTNode> Parser::statement()
+ASTNode *Parser::statement()
 {
     Token tok = peek();
 
@@ -38,7 +50,7 @@ std::shared_ptr<ASTNode> Parser::statement()
     {
     case TokenType::PRINT:
         advance();
-        return std::make_shared<PrintStmt>(expression());
+        return node<PrintStmt>(expression());
 
     case TokenType::COND:
         return parseIfStatement();
@@ -53,13 +65,14 @@ std::shared_ptr<ASTNode> Parser::statement()
 
     case TokenType::IDENT:
     {
-        std::string name = tok.value;
-        size_t lookaheadPos = pos + 1;
-        while (lookaheadPos < tokens.size() && tokens[lookaheadPos].type == TokenType::NEWLINE)
+        std::string name = tok.text();
+        size_t lookaheadPos = 1;
+        while (peekAt(lookaheadPos).type == TokenType::NEWLINE)
             lookaheadPos++;
+        TokenType after = peekAt(lookaheadPos).type;
 
         // Assignment: x = expr
-        if (lookaheadPos < tokens.size() && tokens[lookaheadPos].type == TokenType::ASSIGN)
+        if (after == TokenType::ASSIGN)
         {
             advance(); // consume IDENT
             while (peek().type == TokenType::NEWLINE)
@@ -68,15 +81,15 @@ std::shared_ptr<ASTNode> Parser::statement()
             auto val = expression();
             if (peek().type == TokenType::SEMI)
                 advance();
-            return std::make_shared<AssignStmt>(name, val);
+            return node<AssignStmt>(name, val);
         }
 
         // Function call: foo(...)
-        if (lookaheadPos < tokens.size() && tokens[lookaheadPos].type == TokenType::LPAREN)
+        if (after == TokenType::LPAREN)
         {
             advance(); // consume IDENT
             advance(); // consume '('
-            std::vector<std::shared_ptr<ASTNode>> args;
+            std::vector<ASTNode *> args;
             if (peek().type != TokenType::RPAREN)
             {
                 do
@@ -95,15 +108,33 @@ std::shared_ptr<ASTNode> Parser::statement()
             advance(); // consume ')'
             if (peek().type == TokenType::SEMI)
                 advance(); // optional ';'
-            return std::make_shared<ExprStmt>(
-                std::make_shared<CallExpr>(name, args));
+            return node<ExprStmt>(
+                node<CallExpr>(name, list(args)));
+        }
+
+        // Indexing: x[i] or x[i] = expr
+        if (after == TokenType::LBRACKET)
+        {
+            auto target = expression();
+            if (peek().type == TokenType::ASSIGN && target->type == ASTNodeType::INDEX_EXPR)
+            {
+                advance(); // consume '='
+                auto ie = static_cast<IndexExpr *>(target);
+                auto val = expression();
+                if (peek().type == TokenType::SEMI)
+                    advance();
+                return node<IndexAssignStmt>(ie->target, ie->index, val);
+            }
+            if (peek().type == TokenType::SEMI)
+                advance();
+            return node<ExprStmt>(target);
         }
 
         // Property or Method call: x.something or x.something(...)
-        if (lookaheadPos < tokens.size() && tokens[lookaheadPos].type == TokenType::DOT)
+        if (after == TokenType::DOT)
         {
             advance(); // consume IDENT (x)
-            std::shared_ptr<ASTNode> objectExpr = std::make_shared<IdentExpr>(name);
+            ASTNode *objectExpr = node<IdentExpr>(name);
 
             while (peek().type == TokenType::DOT)
             {
@@ -114,14 +145,14 @@ std::shared_ptr<ASTNode> Parser::statement()
                     throw std::runtime_error("Expected property/method name after '.'");
                 }
 
-                std::string propName = peek().value;
+                std::string propName = peek().text();
                 advance(); // consume IDENT
 
                 if (peek().type == TokenType::LPAREN)
                 {
                     // Method call
                     advance(); // consume '('
-                    std::vector<std::shared_ptr<ASTNode>> args;
+                    std::vector<ASTNode *> args;
                     if (peek().type != TokenType::RPAREN)
                     {
                         do
@@ -139,38 +170,64 @@ std::shared_ptr<ASTNode> Parser::statement()
                     }
                     advance(); // consume ')'
 
-                    objectExpr = std::make_shared<MethodCallExpr>(objectExpr, propName, args);
+                    objectExpr = node<MethodCallExpr>(objectExpr, propName, list(args));
                 }
                 else
                 {
                     // Just property access
-                    objectExpr = std::make_shared<MemberAccessExpr>(objectExpr, propName);
+                    objectExpr = node<MemberAccessExpr>(objectExpr, propName);
                 }
             }
 
+            // x.y[i] and anything after it
+            if (peek().type == TokenType::LBRACKET)
+                objectExpr = parsePostfix(objectExpr);
+
+            // Element assignment: x.y[i] = expr
+            if (peek().type == TokenType::ASSIGN && objectExpr->type == ASTNodeType::INDEX_EXPR)
+            {
+                advance(); // consume '='
+                auto ie = static_cast<IndexExpr *>(objectExpr);
+                auto val = expression();
+                if (peek().type == TokenType::SEMI)
+                    advance();
+                return node<IndexAssignStmt>(ie->target, ie->index, val);
+            }
+
+            // Field assignment: x.y = expr
+            if (peek().type == TokenType::ASSIGN && objectExpr->type == ASTNodeType::MEMBER_ACCESS_EXPR)
+            {
+                advance(); // consume '='
+                auto target = static_cast<MemberAccessExpr *>(objectExpr);
+                auto val = expression();
+                if (peek().type == TokenType::SEMI)
+                    advance();
+                return node<MemberAssignStmt>(target->object, target->member, val);
+            }
+
             if (peek().type == TokenType::SEMI)
                 advance();
-            return std::make_shared<ExprStmt>(objectExpr);
+            return node<ExprStmt>(objectExpr);
         }
 
         advance();
         if (peek().type == TokenType::SEMI)
             advance();
-        return std::make_shared<ExprStmt>(std::make_shared<IdentExpr>(name));
+        return node<ExprStmt>(node<IdentExpr>(name));
     }
 
     case TokenType::OBJECT:
     {
         if (peek().type != TokenType::IDENT)
             throw std::runtime_error("Expected class name after 'pullup'");
-        std::string className = peek().value;
+        std::string className = peek().text();
         advance(); // consume class name
 
         if (peek().type != TokenType::LPAREN)
             throw std::runtime_error("Expected '(' after class name");
         advance(); // consume '('
 
-        std::vector<std::shared_ptr<ASTNode>> args;
+        std::vector<ASTNode *> args;
         if (peek().type != TokenType::RPAREN)
         {
             do
@@ -187,15 +244,35 @@ std::shared_ptr<ASTNode> Parser::statement()
             throw std::runtime_error("Expected ')'");
         advance(); // consume ')'
 
-        return std::make_shared<NewObjectExpr>(className, args);
+        return node<NewObjectExpr>(className, list(args));
+    }
+    case TokenType::RETURN:
+    {
+        advance(); // consume 'return'
+        TokenType next = peek().type;
+        if (next == TokenType::NEWLINE || next == TokenType::SEMI || next == TokenType::ENDOFFILE ||
+            next == TokenType::FUNCEND || next == TokenType::CONDEND)
+            return node<ReturnStmt>(nullptr);
+        return node<ReturnStmt>(expression());
     }
+
+    case TokenType::LOOP:
+        return parseLoop();
+
     case TokenType::CONTINUE:
         advance();
-        return nullptr;
+        if (loopDepth == 0)
+            throw std::runtime_error("'yeet' outside of a loop");
+        return node<ContinueStmt>();
 
     case TokenType::BREAK:
         advance();
-        return nullptr;
+        if (loopDepth == 0)
+            throw std::runtime_error("'sybau' outside of a loop");
+        return node<BreakStmt>();
+
+    case TokenType::LOOPEND:
+        throw std::runtime_error("'periodt' without a loop");
 
     case TokenType::FUNCEND:
         advance();
@@ -215,34 +292,35 @@ std::shared_ptr<ASTNode> Parser::statement()
 
     default:
         auto expr = expression();
-        return std::make_shared<ExprStmt>(expr);
+        return node<ExprStmt>(expr);
     }
 }
 
-std::shared_ptr<ASTNode> Parser::primary()
+ASTNode *Parser::primary()
 {
     Token tok = advance();
-    std::shared_ptr<ASTNode> expr;
+    ASTNode *expr = nullptr;
 
     switch (tok.type)
     {
     case TokenType::INT:
-        expr = std::make_shared<NumberExpr>(std::stoi(tok.value));
-        break;
-    case TokenType::FLOAT:
-        expr = std::make_shared<NumberExpr>(std::stod(tok.value));
+    case TokenType::FLOAT: {
+        double value;
+        if (!parseNumber(tok.value, value)) throw std::runtime_error("Invalid number: " + tok.text());
+        expr = node<NumberExpr>(value);
         break;
+    }
     case TokenType::STRING:
-        expr = std::make_shared<StringExpr>(tok.value);
+        expr = node<StringExpr>(tok.text());
         break;
 
     case TokenType::IDENT:
     {
-        std::string name = tok.value;
+        std::string name = tok.text();
         if (peek().type == TokenType::LPAREN)
         {
             advance(); // '('
-            std::vector<std::shared_ptr<ASTNode>> args;
+            std::vector<ASTNode *> args;
             if (peek().type != TokenType::RPAREN)
             {
                 do
@@ -255,11 +333,11 @@ std::shared_ptr<ASTNode> Parser::primary()
                 } while (true);
             }
             advance();
-            expr = std::make_shared<CallExpr>(name, args);
+            expr = node<CallExpr>(name, list(args));
         }
         else
         {
-            expr = std::make_shared<IdentExpr>(name);
+            expr = node<IdentExpr>(name);
         }
         break;
     }
@@ -268,12 +346,12 @@ std::shared_ptr<ASTNode> Parser::primary()
     {
         if (peek().type != TokenType::IDENT)
             throw std::runtime_error("Expected class name after 'pullup'");
-        std::string className = peek().value;
+        std::string className = peek().text();
         advance();
 
         advance();
 
-        std::vector<std::shared_ptr<ASTNode>> args;
+        std::vector<ASTNode *> args;
         if (peek().type != TokenType::RPAREN)
         {
             do
@@ -288,15 +366,15 @@ std::shared_ptr<ASTNode> Parser::primary()
 
         advance();
 
-        expr = std::make_shared<NewObjectExpr>(className, args);
+        expr = node<NewObjectExpr>(className, list(args));
         break;
     }
 
     case TokenType::TRUE:
-        expr = std::make_shared<NumberExpr>(1);
+        expr = node<NumberExpr>(1);
         break;
     case TokenType::FALSE:
-        expr = std::make_shared<NumberExpr>(0);
+        expr = node<NumberExpr>(0);
         break;
 
     case TokenType::LPAREN:
@@ -308,7 +386,7 @@ std::shared_ptr<ASTNode> Parser::primary()
         break;
     case TokenType::LBRACKET:  // <-- new
         {
-            std::vector<std::shared_ptr<ASTNode>> elements;
+            std::vector<ASTNode *> elements;
             if (peek().type != TokenType::RBRACKET) {
                 do {
                     elements.push_back(expression());
@@ -321,30 +399,96 @@ std::shared_ptr<ASTNode> Parser::primary()
             if (peek().type != TokenType::RBRACKET)
                 throw std::runtime_error("Expected ']' at end of array literal");
             advance(); // consume ']'
-            expr = std::make_shared<ArrayLiteral>(elements);
+            expr = node<ArrayLiteral>(list(elements));
+            break;
+        }
+    case TokenType::LBRACE: // dict literal, may span lines
+        {
+            std::vector<ASTNode *> keys;
+            std::vector<ASTNode *> values;
+            while (peek().type == TokenType::NEWLINE)
+                advance();
+            while (!isAtEnd() && peek().type != TokenType::RBRACE) {
+                keys.push_back(expression());
+                if (peek().type != TokenType::COLON)
+                    throw std::runtime_error("Expected ':' after dict key");
+                advance(); // consume ':'
+                values.push_back(expression());
+                while (peek().type == TokenType::NEWLINE)
+                    advance();
+                if (peek().type != TokenType::COMMA)
+                    break;
+                advance(); // consume ','
+                while (peek().type == TokenType::NEWLINE)
+                    advance();
+            }
+            if (peek().type != TokenType::RBRACE)
+                throw std::runtime_error("Expected '}' at end of dict literal");
+            advance(); // consume '}'
+            expr = node<DictLiteral>(list(keys), list(values));
             break;
         }
 
         default:
-            throw std::runtime_error("Unexpected token in expression: " + tok.value);
+            throw std::runtime_error("Unexpected token in expression: " + tok.text());
     }
 
-    // handle array indexing e.g., a[0]
-
-
+    return parsePostfix(expr);
+}
 
-    while (peek().type == TokenType::LBRACKET) {
-        advance(); // '['
-        auto indexExpr = expression();
-        if (peek().type != TokenType::RBRACKET)
-            throw std::runtime_error("Expected ']' after index");
-        advance(); // ']'
-        expr = std::make_shared<IndexExpr>(expr, indexExpr);
+// handles what can follow a primary: indexing a[0], member access a.b and method calls a.b(...)
+ASTNode *Parser::parsePostfix(ASTNode *expr)
+{
+    while (true)
+    {
+        if (peek().type == TokenType::LBRACKET)
+        {
+            advance(); // '['
+            auto indexExpr = expression();
+            if (peek().type != TokenType::RBRACKET)
+                throw std::runtime_error("Expected ']' after index");
+            advance(); // ']'
+            expr = node<IndexExpr>(expr, indexExpr);
+        }
+        else if (peek().type == TokenType::DOT)
+        {
+            advance(); // '.'
+            if (peek().type != TokenType::IDENT)
+                throw std::runtime_error("Expected property/method name after '.'");
+            std::string name = advance().text();
+            if (peek().type == TokenType::LPAREN)
+            {
+                advance(); // '('
+                std::vector<ASTNode *> args;
+                if (peek().type != TokenType::RPAREN)
+                {
+                    do
+                    {
+                        args.push_back(expression());
+                        if (peek().type == TokenType::COMMA)
+                            advance();
+                        else
+                            break;
+                    } while (true);
+                }
+                if (peek().type != TokenType::RPAREN)
+                    throw std::runtime_error("Expected ')'");
+                advance(); // ')'
+                expr = node<MethodCallExpr>(expr, name, list(args));
+            }
+            else
+            {
+                expr = node<MemberAccessExpr>(expr, name);
+            }
+        }
+        else
+        {
+            return expr;
+        }
     }
-    return expr;
 }
 
-std::shared_ptr<ASTNode> Parser::expression()
+ASTNode *Parser::expression()
 {
     auto left = parseTerm();
 
@@ -359,13 +503,13 @@ std::shared_ptr<ASTNode> Parser::expression()
     {
         Token op = advance();
         auto right = parseTerm();
-        left = std::make_shared<BinaryExpr>(left, op.value, right);
+        left = node<BinaryExpr>(left, op.text(), right);
     }
 
     return left;
 }
 
-std::shared_ptr<ASTNode> Parser::parseTerm()
+ASTNode *Parser::parseTerm()
 {
     auto left = parseFactor();
     while (!isAtEnd() &&
@@ -374,12 +518,12 @@ std::shared_ptr<ASTNode> Parser::parseTerm()
     {
         Token op = advance();
         auto right = parseFactor();
-        left = std::make_shared<BinaryExpr>(left, op.value, right);
+        left = node<BinaryExpr>(left, op.text(), right);
     }
     return left;
 }
 
-std::shared_ptr<ASTNode> Parser::parseFactor()
+ASTNode *Parser::parseFactor()
 {
     auto left = parseUnary();
     while (!isAtEnd() &&
@@ -389,12 +533,12 @@ std::shared_ptr<ASTNode> Parser::parseFactor()
     {
         Token op = advance();
         auto right = parseUnary();
-        left = std::make_shared<BinaryExpr>(left, op.value, right);
+        left = node<BinaryExpr>(left, op.text(), right);
     }
     return left;
 }
 
-std::shared_ptr<ASTNode> Parser::parseUnary()
+ASTNode *Parser::parseUnary()
 {
     if (!isAtEnd() &&
         (peek().type == TokenType::REV ||  
@@ -402,7 +546,7 @@ std::shared_ptr<ASTNode> Parser::parseUnary()
     {
         Token op = advance();
         auto right = parseUnary();
-        return std::make_shared<UnaryExpr>(op.value, right);
+        return node<UnaryExpr>(op.text(), right);
     }
     return primary();
 }
@@ -449,7 +593,7 @@ const char *ASTNodeTypeToString(ASTNodeType type)
     }
 }
 
-std::shared_ptr<ASTNode> Parser::parseInput()
+ASTNode *Parser::parseInput()
 {
     advance(); // consume 'spill'
     auto nameTok = peek();
@@ -458,18 +602,18 @@ std::shared_ptr<ASTNode> Parser::parseInput()
         throw std::runtime_error("Expected variable name after 'spill'");
     }
     advance();
-    return std::make_shared<InputStmt>(nameTok.value);
+    return node<InputStmt>(nameTok.text());
 }
 
-std::shared_ptr<ASTNode> Parser::parseIfStatement()
+ASTNode *Parser::parseIfStatement()
 {
-    std::shared_ptr<IfStmt> head = nullptr;
-    std::shared_ptr<IfStmt> current = nullptr;
+    IfStmt *head = nullptr;
+    IfStmt *current = nullptr;
 
     while (!isAtEnd() && peek().type == TokenType::COND)
     {
         Token token = advance();
-        std::shared_ptr<ASTNode> condExpr = nullptr;
+        ASTNode *condExpr = nullptr;
 
         if (token.condType == CondType::IF || token.condType == CondType::ELSEIF)
         {
@@ -482,11 +626,12 @@ std::shared_ptr<ASTNode> Parser::parseIfStatement()
         }
         advance(); // consume ':'
 
-        std::vector<std::shared_ptr<ASTNode>> body;
+        std::vector<ASTNode *> body;
         while (!isAtEnd() &&
                !(peek().type == TokenType::COND &&
                  (peek().condType == CondType::ELSEIF || peek().condType == CondType::ELSE)) &&
                peek().type != TokenType::CONDEND &&
+               peek().type != TokenType::LOOPEND &&
                peek().type != TokenType::ENDOFFILE)
         {
             if (peek().type == TokenType::NEWLINE)
@@ -499,7 +644,7 @@ std::shared_ptr<ASTNode> Parser::parseIfStatement()
                 body.push_back(stmt);
         }
 
-        auto newNode = std::make_shared<IfStmt>(condExpr, body);
+        auto newNode = node<IfStmt>(condExpr, list(body));
 
         if (!head)
         {
@@ -519,7 +664,66 @@ std::shared_ptr<ASTNode> Parser::parseIfStatement()
     return head;
 }
 
-std::shared_ptr<ASTNode> Parser::parseFunction()
+// loop cond: ... periodt
+// loop i = from, to: ... periodt   (also loop i = from, to, step:)
+ASTNode *Parser::parseLoop()
+{
+    advance(); // consume 'loop'
+
+    std::string varName;
+    ASTNode *cond = nullptr;
+    ASTNode *from = nullptr;
+    ASTNode *to = nullptr;
+    ASTNode *step = nullptr;
+    if (peek().type == TokenType::IDENT && peekAt(1).type == TokenType::ASSIGN)
+    {
+        varName = advance().text();
+        advance(); // consume '='
+        from = expression();
+        if (peek().type != TokenType::COMMA)
+            throw std::runtime_error("Expected ',' between the bounds of a counted loop");
+        advance();
+        to = expression();
+        if (peek().type == TokenType::COMMA)
+        {
+            advance();
+            step = expression();
+        }
+    }
+    else
+    {
+        cond = expression();
+    }
+
+    if (peek().type != TokenType::COLON)
+        throw std::runtime_error("Expected ':' after loop header");
+    advance(); // consume ':'
+
+    loopDepth++;
+    std::vector<ASTNode *> body;
+    while (!isAtEnd() && peek().type != TokenType::LOOPEND && peek().type != TokenType::ENDOFFILE)
+    {
+        if (peek().type == TokenType::NEWLINE || peek().type == TokenType::SEMI)
+        {
+            advance();
+            continue;
+        }
+        auto stmt = statement();
+        if (stmt)
+            body.push_back(stmt);
+    }
+    loopDepth--;
+
+    if (peek().type != TokenType::LOOPEND)
+        throw std::runtime_error("Expected 'periodt' to close loop");
+    advance();
+
+    if (cond)
+        return node<LoopStmt>(cond, list(body));
+    return node<CountedLoopStmt>(varName, from, to, step, list(body));
+}
+
+ASTNode *Parser::parseFunction()
 {
     advance(); // consume 'drip'
 
@@ -537,7 +741,7 @@ std::shared_ptr<ASTNode> Parser::parseFunction()
     {
         if (peek().type != TokenType::IDENT)
             throw std::runtime_error("Expected parameter name");
-        params.push_back(peek().value);
+        params.push_back(peek().text());
         advance();
         if (peek().type == TokenType::COMMA)
             advance();
@@ -548,7 +752,25 @@ std::shared_ptr<ASTNode> Parser::parseFunction()
         throw std::runtime_error("Expected ':' after function header");
     // advance();
 
-    std::vector<std::shared_ptr<ASTNode>> body;
+    if (!deferBodies)
+        return node<FuncDef>(nameTok.text(), params, functionBody());
+
+    // most drips of a big script are never called, so the body is only skipped over here
+    // and parsed by parseDeferredBody when it is first needed
+    auto fn = node<FuncDef>(nameTok.text(), params, NodeList<>());
+    fn->deferred = source;
+    fn->bodyStart = peek().offset;
+    skipFunctionBody();
+    fn->bodyEnd = peek().offset;
+    return fn;
+}
+
+NodeList<> Parser::functionBody()
+{
+    int enclosingLoops = loopDepth;
+    loopDepth = 0; // sybau/yeet can't reach a loop around the drip
+
+    std::vector<ASTNode *> body;
 
     while (!isAtEnd() &&
            peek().type != TokenType::ENDOFFILE &&
@@ -574,10 +796,94 @@ std::shared_ptr<ASTNode> Parser::parseFunction()
         }
     }
 
-    return std::make_shared<FuncDef>(nameTok.value, params, body);
+    loopDepth = enclosingLoops;
+    return list(body);
+}
+
+void parseDeferredBody(FuncDef &fn)
+{
+    if (!fn.deferred)
+        return;
+    const DeferredSource &src = *fn.deferred;
+    Lexer lexer(src.text.substr(0, fn.bodyEnd), fn.bodyStart);
+    Parser parser(lexer, src);
+    NodeList<> body = parser.functionBody();
+    if (!parser.isAtEnd())
+        throw std::runtime_error("Unexpected token in body of " + fn.name);
+    fn.body = Optimizer(*src.arena).block(body); // the rest of the script was optimized right after parsing
+    fn.deferred = nullptr;
+}
+
+// the skip* functions mirror the loops of functionBody, parseIfStatement, parseLoop and parseClass.
+// Every other token can only be part of a simple statement or an expression, which never reach
+// past a block keyword, so those are stepped over one by one.
+void Parser::skipFunctionBody()
+{
+    while (!isAtEnd() &&
+           peek().type != TokenType::FUNC &&
+           peek().type != TokenType::CLASS &&
+           !(peek().type == TokenType::COND && peek().condType == CondType::ELSE) && peek().type != TokenType::FUNCEND)
+        skipStatement();
+}
+
+void Parser::skipStatement()
+{
+    switch (peek().type)
+    {
+    case TokenType::COND:
+        skipIf();
+        break;
+    case TokenType::LOOP:
+        skipLoop();
+        break;
+    case TokenType::FUNC:
+        advance(); // the header is plain tokens up to the body
+        skipFunctionBody();
+        break;
+    case TokenType::CLASS:
+        skipClass();
+        break;
+    default:
+        advance();
+        break;
+    }
+}
+
+void Parser::skipIf()
+{
+    while (!isAtEnd() && peek().type == TokenType::COND)
+    {
+        CondType kind = advance().condType;
+        while (!isAtEnd() &&
+               !(peek().type == TokenType::COND &&
+                 (peek().condType == CondType::ELSEIF || peek().condType == CondType::ELSE)) &&
+               peek().type != TokenType::CONDEND &&
+               peek().type != TokenType::LOOPEND)
+            skipStatement();
+        if (kind == CondType::ELSE)
+            break;
+    }
+}
+
+void Parser::skipLoop()
+{
+    advance(); // consume 'loop'
+    while (!isAtEnd() && peek().type != TokenType::LOOPEND)
+        skipStatement();
+    if (peek().type == TokenType::LOOPEND)
+        advance();
+}
+
+void Parser::skipClass()
+{
+    advance(); // consume 'rizz'
+    while (!isAtEnd() && peek().type != TokenType::CLASSEND)
+        skipStatement();
+    if (peek().type == TokenType::CLASSEND)
+        advance();
 }
 
-std::shared_ptr<ASTNode> Parser::parseClass()
+ASTNode *Parser::parseClass()
 {
     advance();
 
@@ -590,7 +896,7 @@ std::shared_ptr<ASTNode> Parser::parseClass()
         throw std::runtime_error("Expected ':' after class name");
     advance();
 
-    std::vector<std::shared_ptr<FuncDef>> methods;
+    std::vector<FuncDef *> methods;
 
     while (!isAtEnd() &&
            peek().type != TokenType::ENDOFFILE &&
@@ -604,7 +910,7 @@ std::shared_ptr<ASTNode> Parser::parseClass()
 
         if (peek().type == TokenType::FUNC)
         {
-            auto fn = std::dynamic_pointer_cast<FuncDef>(parseFunction());
+            auto fn = static_cast<FuncDef *>(parseFunction());
             if (!fn)
                 throw std::runtime_error("Expected function inside class");
             methods.push_back(fn);
@@ -619,5 +925,5 @@ std::shared_ptr<ASTNode> Parser::parseClass()
         throw std::runtime_error("Expected 'goner' to close class");
     advance();
 
-    return std::make_shared<ClassDef>(nameTok.value, methods);
+    return node<ClassDef>(nameTok.text(), list(methods));
 }
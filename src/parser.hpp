@@ -4,26 +4,79 @@
 #include "ast.hpp"
 
 class Parser {
-    std::vector<Token> tokens;
-    int pos = 0;
+    // Tokens are pulled from the lexer only when the parser looks at them and live in a small
+    // ring buffer, so parsing needs no token memory proportional to the script.
+    Lexer &lexer;
+    std::vector<Token> lookahead = std::vector<Token>(8);   // size is a power of two
+    size_t head = 0;    // slot of the next token
+    size_t count = 0;   // tokens lexed but not consumed yet
+    int loopDepth = 0;   // loops around the statement being parsed, for sybau/yeet
+    Script script;   // filled while parsing
+    AstArena *arena;   // every node goes here: the arena of script, or of the Script a deferred body belongs to
+    const DeferredSource *source;   // what the drips parsed from here read their bodies from
+
+    template <class T, class... Args>
+    T *node(Args &&...args) { return arena->make<T>(std::forward<Args>(args)...); }
+
+    template <class T>
+    NodeList<T> list(const std::vector<T *> &items) { return makeList(*arena, items); }
+
+    void growLookahead();
+
+    // the body of a deferred drip, parsed into the arena of the Script it belongs to
+    Parser(Lexer &l, const DeferredSource &src) : lexer(l), arena(src.arena), source(&src) {}
+    friend void parseDeferredBody(FuncDef &fn);
+
+    NodeList<> functionBody();
+
+    // pre-parse: steps over a drip body following only the block keywords, and stops on the same
+    // token functionBody() would. Nothing is built and syntax errors wait for the real parse.
+    void skipFunctionBody();
+    void skipStatement();
+    void skipIf();
+    void skipLoop();
+    void skipClass();
 
 public:
-    Parser(const std::vector<Token>& t) : tokens(t) {}
-
-    bool isAtEnd() { return pos >= tokens.size(); }
-    Token peek() { return tokens[pos]; }
-    Token advance() { return tokens[pos++]; }
-
-    std::vector<std::shared_ptr<ASTNode>> parse();
-    std::shared_ptr<ASTNode> statement();
-    std::shared_ptr<ASTNode> expression();
-    std::shared_ptr<ASTNode> primary();
-    std::shared_ptr<ASTNode> parseInput();
-    std::shared_ptr<ASTNode> parseIfStatement();
-    std::shared_ptr<ASTNode> parseUnary();
-    std::shared_ptr<ASTNode> parseTerm();
-    std::shared_ptr<ASTNode> parseFactor();
-    std::shared_ptr<ASTNode> parseFunction();
-    std::shared_ptr<ASTNode> parseClass();
-    std::shared_ptr<ASTNode> parsePostfix();
+    Parser(Lexer &l)
+        : lexer(l), arena(script.arena.get()),
+          source(arena->make<DeferredSource>(DeferredSource{l.source(), arena})) {}
+
+    //n tokens past the current one; the reference stays valid until the next advance()
+    const Token &peekAt(size_t n) {
+        while (count <= n) {
+            if (count == lookahead.size()) growLookahead();
+            lookahead[(head + count) & (lookahead.size() - 1)] = lexer.getNextToken();
+            count++;
+        }
+        return lookahead[(head + n) & (lookahead.size() - 1)];
+    }
+    const Token &peek() { return peekAt(0); }
+    Token advance() {
+        Token tok = peek();
+        head = (head + 1) & (lookahead.size() - 1);
+        count--;
+        return tok;
+    }
+    bool isAtEnd() { return peek().type == TokenType::ENDOFFILE; }
+
+    // when false every drip body is parsed right away, for engines that need them all up front
+    bool deferBodies = true;
+
+    Script parse();
+    ASTNode *statement();
+    ASTNode *expression();
+    ASTNode *primary();
+    ASTNode *parseInput();
+    ASTNode *parseIfStatement();
+    ASTNode *parseUnary();
+    ASTNode *parseTerm();
+    ASTNode *parseFactor();
+    ASTNode *parseLoop();
+    ASTNode *parseFunction();
+    ASTNode *parseClass();
+    ASTNode *parsePostfix(ASTNode *expr);
 };
+
+//parses the body of a drip on its first use; throws on a syntax error and leaves it deferred
+void parseDeferredBody(FuncDef &fn);
@@ -0,0 +1,295 @@
+// src/resolver.cpp
+#include "resolver.hpp"
+#include "parser.hpp"
+
+void Resolver::resolve(NodeList<> program) {
+    function = nullptr;
+    locals.clear();
+    for (auto &stmt : program) statement(stmt);
+}
+
+int Resolver::globalSlot(const std::string &name) {
+    auto it = globalIds.find(name);
+    if (it != globalIds.end()) return it->second;
+    int slot = (int)globals.size();
+    globals.push_back(name);
+    globalIds[name] = slot;
+    return slot;
+}
+
+void Resolver::declareLocal(const std::string &name) {
+    if (locals.count(name)) return;
+    locals[name] = function->numLocals++;
+    function->localGlobals.push_back(globalSlot(name));
+}
+
+//every name assigned anywhere in a function body is local to that call, nested drip/rizz get their own scope.
+//a[i] = v, a.push(v) and a.pop() count as assigning a: the first one in a call copies the global
+//array into the local (see placeSlot in the engines), so functions never change a global variable.
+void Resolver::declareAssigned(NodeList<> body) {
+    for (auto &stmt : body) {
+        if (!stmt) continue;
+        switch (stmt->type) {
+        case ASTNodeType::ASSIGN_STMT:
+            declareLocal(static_cast<AssignStmt *>(stmt)->name);
+            declareChanged(static_cast<AssignStmt *>(stmt)->value);
+            break;
+        case ASTNodeType::INPUT_STMT:
+            declareLocal(static_cast<InputStmt *>(stmt)->varName);
+            break;
+        case ASTNodeType::IF_STMT:
+            for (auto branch = static_cast<IfStmt *>(stmt); branch; branch = branch->next) {
+                if (branch->condition) declareChanged(branch->condition);
+                declareAssigned(branch->thenBranch);
+            }
+            break;
+        case ASTNodeType::LOOP_STMT:
+            declareChanged(static_cast<LoopStmt *>(stmt)->condition);
+            declareAssigned(static_cast<LoopStmt *>(stmt)->body);
+            break;
+        case ASTNodeType::COUNTED_LOOP_STMT: {
+            auto loop = static_cast<CountedLoopStmt *>(stmt);
+            declareLocal(loop->varName);
+            declareChanged(loop->from);
+            declareChanged(loop->to);
+            if (loop->step) declareChanged(loop->step);
+            declareAssigned(loop->body);
+            break;
+        }
+        case ASTNodeType::INDEX_ASSIGN_STMT: {
+            auto ia = static_cast<IndexAssignStmt *>(stmt);
+            if (isPlace(ia->target)) declarePlaceRoot(ia->target);
+            declareChanged(ia->target);
+            declareChanged(ia->index);
+            declareChanged(ia->value);
+            break;
+        }
+        case ASTNodeType::PRINT_STMT:
+            declareChanged(static_cast<PrintStmt *>(stmt)->value);
+            break;
+        case ASTNodeType::EXPR_STMT:
+            declareChanged(static_cast<ExprStmt *>(stmt)->expr);
+            break;
+        case ASTNodeType::RETURN_STMT:
+            if (auto value = static_cast<ReturnStmt *>(stmt)->value) declareChanged(value);
+            break;
+        case ASTNodeType::MEMBER_ASSIGN_STMT:
+            declareChanged(static_cast<MemberAssignStmt *>(stmt)->object);
+            declareChanged(static_cast<MemberAssignStmt *>(stmt)->value);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+//the variable a place is reached from becomes local, nothing to do for a field (self.rows[i])
+void Resolver::declarePlaceRoot(ASTNode *place) {
+    while (place->type == ASTNodeType::INDEX_EXPR) place = static_cast<IndexExpr *>(place)->target;
+    if (place->type == ASTNodeType::IDENT) declareLocal(static_cast<IdentExpr *>(place)->name);
+}
+
+//finds the push/pop calls in an expression, the ones on a place change its variable
+void Resolver::declareChanged(ASTNode *expr) {
+    switch (expr->type) {
+    case ASTNodeType::METHOD_CALL_EXPR: {
+        auto mc = static_cast<MethodCallExpr *>(expr);
+        if (isArrayMethod(mc->methodSymbol) && isPlace(mc->object)) declarePlaceRoot(mc->object);
+        declareChanged(mc->object);
+        for (auto a : mc->arguments) declareChanged(a);
+        break;
+    }
+    case ASTNodeType::BINARY_EXPR:
+        declareChanged(static_cast<BinaryExpr *>(expr)->left);
+        declareChanged(static_cast<BinaryExpr *>(expr)->right);
+        break;
+    case ASTNodeType::UNARY_EXPR:
+        declareChanged(static_cast<UnaryExpr *>(expr)->operand);
+        break;
+    case ASTNodeType::INDEX_EXPR:
+        declareChanged(static_cast<IndexExpr *>(expr)->target);
+        declareChanged(static_cast<IndexExpr *>(expr)->index);
+        break;
+    case ASTNodeType::MEMBER_ACCESS_EXPR:
+        declareChanged(static_cast<MemberAccessExpr *>(expr)->object);
+        break;
+    case ASTNodeType::CALL_EXPR:
+        for (auto a : static_cast<CallExpr *>(expr)->args) declareChanged(a);
+        break;
+    case ASTNodeType::ARRAY_LITERAL:
+        for (auto e : static_cast<ArrayLiteral *>(expr)->elements) declareChanged(e);
+        break;
+    case ASTNodeType::DICT_LITERAL:
+        for (auto k : static_cast<DictLiteral *>(expr)->keys) declareChanged(k);
+        for (auto v : static_cast<DictLiteral *>(expr)->values) declareChanged(v);
+        break;
+    default:
+        break;
+    }
+}
+
+VarRef Resolver::lookup(const std::string &name) {
+    VarRef ref;
+    auto it = locals.find(name);
+    if (function && it != locals.end()) {
+        ref.local = true;
+        ref.slot = it->second;
+    } else {
+        ref.slot = globalSlot(name);
+    }
+    return ref;
+}
+
+void Resolver::resolveBody(FuncDef &fn) {
+    parseDeferredBody(fn);
+    resolveFunction(fn, fn.isMethod);
+}
+
+void Resolver::resolveFunction(FuncDef &fn, bool isMethod) {
+    if (fn.deferred) {
+        if (deferBodies) return;
+        parseDeferredBody(fn);
+    }
+    FuncDef *enclosing = function;
+    auto enclosingLocals = std::move(locals);
+    function = &fn;
+    locals.clear();
+    fn.numLocals = 0;
+    fn.selfSlot = -1;
+    fn.localGlobals.clear();
+
+    for (auto &p : fn.params) declareLocal(p);
+    if (isMethod) {
+        declareLocal("self");
+        fn.selfSlot = locals["self"];
+    }
+    declareAssigned(fn.body);
+    for (auto &stmt : fn.body) statement(stmt);
+
+    function = enclosing;
+    locals = std::move(enclosingLocals);
+}
+
+void Resolver::statement(ASTNode *node) {
+    if (!node) return;
+    switch (node->type) {
+    case ASTNodeType::PRINT_STMT:
+        expression(static_cast<PrintStmt *>(node)->value);
+        break;
+    case ASTNodeType::ASSIGN_STMT: {
+        auto stmt = static_cast<AssignStmt *>(node);
+        expression(stmt->value);
+        stmt->ref = lookup(stmt->name);
+        break;
+    }
+    case ASTNodeType::INPUT_STMT: {
+        auto stmt = static_cast<InputStmt *>(node);
+        stmt->ref = lookup(stmt->varName);
+        break;
+    }
+    case ASTNodeType::EXPR_STMT:
+        expression(static_cast<ExprStmt *>(node)->expr);
+        break;
+    case ASTNodeType::MEMBER_ASSIGN_STMT: {
+        auto stmt = static_cast<MemberAssignStmt *>(node);
+        expression(stmt->object);
+        expression(stmt->value);
+        break;
+    }
+    case ASTNodeType::INDEX_ASSIGN_STMT: {
+        auto stmt = static_cast<IndexAssignStmt *>(node);
+        expression(stmt->target);
+        expression(stmt->index);
+        expression(stmt->value);
+        break;
+    }
+    case ASTNodeType::IF_STMT:
+        for (auto branch = static_cast<IfStmt *>(node); branch; branch = branch->next) {
+            if (branch->condition) expression(branch->condition);
+            for (auto &s : branch->thenBranch) statement(s);
+        }
+        break;
+    case ASTNodeType::LOOP_STMT: {
+        auto loop = static_cast<LoopStmt *>(node);
+        expression(loop->condition);
+        for (auto s : loop->body) statement(s);
+        break;
+    }
+    case ASTNodeType::COUNTED_LOOP_STMT: {
+        auto loop = static_cast<CountedLoopStmt *>(node);
+        expression(loop->from);
+        expression(loop->to);
+        expression(loop->step);
+        loop->ref = lookup(loop->varName);
+        for (auto s : loop->body) statement(s);
+        break;
+    }
+    case ASTNodeType::FUNC_DEF:
+        resolveFunction(*static_cast<FuncDef *>(node), false);
+        break;
+    case ASTNodeType::CLASS_DEF:
+        for (auto &m : static_cast<ClassDef *>(node)->methods) resolveFunction(*m, true);
+        break;
+    case ASTNodeType::RETURN_STMT: {
+        auto stmt = static_cast<ReturnStmt *>(node);
+        if (stmt->value) expression(stmt->value);
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+void Resolver::expression(ASTNode *node) {
+    if (!node) return;
+    switch (node->type) {
+    case ASTNodeType::IDENT: {
+        auto e = static_cast<IdentExpr *>(node);
+        e->ref = lookup(e->name);
+        break;
+    }
+    case ASTNodeType::BINARY_EXPR: {
+        auto be = static_cast<BinaryExpr *>(node);
+        expression(be->left);
+        expression(be->right);
+        break;
+    }
+    case ASTNodeType::UNARY_EXPR:
+        expression(static_cast<UnaryExpr *>(node)->operand);
+        break;
+    case ASTNodeType::INDEX_EXPR: {
+        auto ie = static_cast<IndexExpr *>(node);
+        expression(ie->target);
+        expression(ie->index);
+        break;
+    }
+    case ASTNodeType::ARRAY_LITERAL:
+        for (auto &el : static_cast<ArrayLiteral *>(node)->elements) expression(el);
+        break;
+    case ASTNodeType::DICT_LITERAL: {
+        auto dict = static_cast<DictLiteral *>(node);
+        for (size_t i = 0; i < dict->keys.size(); ++i) {
+            expression(dict->keys[i]);
+            expression(dict->values[i]);
+        }
+        break;
+    }
+    case ASTNodeType::CALL_EXPR: {
+        auto call = static_cast<CallExpr *>(node);
+        for (auto &a : call->args) expression(a);
+        call->calleeVar = lookup(call->callee);
+        break;
+    }
+    case ASTNodeType::METHOD_CALL_EXPR: {
+        auto mc = static_cast<MethodCallExpr *>(node);
+        expression(mc->object);
+        for (auto &a : mc->arguments) expression(a);
+        break;
+    }
+    case ASTNodeType::MEMBER_ACCESS_EXPR:
+        expression(static_cast<MemberAccessExpr *>(node)->object);
+        break;
+    default:
+        break;
+    }
+}
@@ -0,0 +1,39 @@
+// src/resolver.hpp
+//runs once before execution and decides for every variable use whether it is a local of the
+//enclosing function (a frame slot) or a global (a global slot), so nothing is looked up by name at runtime
+#pragma once
+#include "ast.hpp"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class Resolver {
+public:
+    void resolve(NodeList<> program);
+
+    // parses and resolves a drip that resolve() left deferred, before its first call
+    void resolveBody(FuncDef &fn);
+
+    // when set, drips whose body is still unparsed are skipped by resolve() and left for resolveBody,
+    // otherwise they are parsed as they are met
+    bool deferBodies = false;
+
+    int globalSlot(const std::string &name);
+    const std::vector<std::string> &globalNames() const { return globals; }
+
+private:
+    std::vector<std::string> globals;                   // name of every global slot
+    std::unordered_map<std::string, int> globalIds;
+    FuncDef *function = nullptr;                        // function being resolved, nullptr at top level
+    std::unordered_map<std::string, int> locals;
+
+    void resolveFunction(FuncDef &fn, bool isMethod);
+    void declareLocal(const std::string &name);
+    void declareAssigned(NodeList<> body);
+    void declareChanged(ASTNode *expr);
+    void declarePlaceRoot(ASTNode *place);
+    VarRef lookup(const std::string &name);
+
+    void statement(ASTNode *node);
+    void expression(ASTNode *node);
+};
@@ -0,0 +1,78 @@
+// src/source.cpp
+#include "source.hpp"
+#include <fstream>
+#include <sstream>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#elif !defined(__EMSCRIPTEN__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define RIZZ_HAVE_MMAP 1
+#endif
+
+SourceFile::~SourceFile() {
+    if (!mapped) return;
+#if defined(_WIN32)
+    UnmapViewOfFile(data);
+    CloseHandle((HANDLE)mapping);
+#elif defined(RIZZ_HAVE_MMAP)
+    munmap((void *)data, size);
+#endif
+}
+
+bool SourceFile::open(const std::string &path) {
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file != INVALID_HANDLE_VALUE) {
+        LARGE_INTEGER length;
+        if (GetFileSizeEx(file, &length) && length.QuadPart > 0) {
+            HANDLE view = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (view) {
+                void *p = MapViewOfFile(view, FILE_MAP_READ, 0, 0, 0);
+                if (p) {
+                    CloseHandle(file); // the mapping keeps the file open
+                    data = (const char *)p;
+                    size = (size_t)length.QuadPart;
+                    mapping = view;
+                    mapped = true;
+                    return true;
+                }
+                CloseHandle(view);
+            }
+        }
+        CloseHandle(file);
+    }
+#elif defined(RIZZ_HAVE_MMAP)
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        struct stat st;
+        if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+            void *p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                close(fd); // the mapping keeps the file open
+                posix_madvise(p, (size_t)st.st_size, POSIX_MADV_SEQUENTIAL); // read front to back once
+                data = (const char *)p;
+                size = (size_t)st.st_size;
+                mapped = true;
+                return true;
+            }
+        }
+        close(fd);
+    }
+#endif
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) return false;
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    contents = buffer.str();
+    data = contents.data();
+    size = contents.size();
+    return true;
+}
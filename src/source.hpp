@@ -0,0 +1,26 @@
+// src/source.hpp
+//read-only view of a script file: mapped into memory where the os allows it, so the lexer reads
+//straight from the page cache and nothing is copied however big the script is
+#pragma once
+#include <string>
+#include <string_view>
+
+class SourceFile {
+public:
+    SourceFile() = default;
+    SourceFile(const SourceFile &) = delete;
+    SourceFile &operator=(const SourceFile &) = delete;
+    ~SourceFile();
+
+    bool open(const std::string &path);   // false when the file can't be read
+    std::string_view text() const { return std::string_view(data, size); }
+
+private:
+    const char *data = nullptr;
+    size_t size = 0;
+    bool mapped = false;
+    std::string contents;   // used when the file could not be mapped (wasm, empty files, pipes)
+#ifdef _WIN32
+    void *mapping = nullptr;
+#endif
+};
@@ -0,0 +1,44 @@
+// src/symbol.cpp
+#include "symbol.hpp"
+#include <deque>
+#include <unordered_map>
+
+namespace {
+struct SymbolTable {
+    std::deque<std::string> names;                       // by id, a deque so the views below stay valid
+    std::unordered_map<std::string_view, Symbol> ids;    // views into names
+
+    SymbolTable() {
+        add("init"); // in the order of SYMBOL_INIT...
+        add("push");
+        add("pop");
+    }
+
+    Symbol add(std::string_view name) {
+        Symbol id = (Symbol)names.size();
+        names.emplace_back(name);
+        ids.emplace(names.back(), id);
+        return id;
+    }
+};
+
+SymbolTable &table() {
+    static SymbolTable t;
+    return t;
+}
+}
+
+Symbol internSymbol(std::string_view name) {
+    SymbolTable &t = table();
+    auto it = t.ids.find(name);
+    if (it != t.ids.end()) return it->second;
+    return t.add(name);
+}
+
+const std::string &symbolName(Symbol symbol) {
+    return table().names[symbol];
+}
+
+size_t symbolCount() {
+    return table().names.size();
+}
@@ -0,0 +1,35 @@
+// src/symbol.hpp
+//identifiers interned once into dense ids, shared by the whole run. Nodes carry the id of every name
+//the engines look up at runtime (drips, classes, members), so those tables are indexed by the id
+//or keyed by a plain integer and no name is hashed while a script runs.
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using Symbol = uint32_t;
+
+// interned before anything else so the engines can use them without a lookup
+enum : Symbol { SYMBOL_INIT = 0, SYMBOL_PUSH, SYMBOL_POP };
+
+//id of name, the next free one the first time name is seen
+Symbol internSymbol(std::string_view name);
+
+const std::string &symbolName(Symbol symbol);
+
+//every id handed out so far is below this
+size_t symbolCount();
+
+//table indexed directly by Symbol, grows to the highest id stored. Reading an id nothing was stored
+//under gives T(), so a miss costs a bounds check and no hashing.
+template <class T>
+struct SymbolMap {
+    std::vector<T> items;
+
+    T get(Symbol symbol) const { return symbol < items.size() ? items[symbol] : T(); }
+    T &operator[](Symbol symbol) {
+        if (symbol >= items.size()) items.resize(symbol + 1);
+        return items[symbol];
+    }
+};
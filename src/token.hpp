@@ -1,20 +1,26 @@
 #pragma once
+#include <cstddef>
 #include <string>
+#include <string_view>
 //defining all kind of identifiers which will be used in the language
 enum class TokenType {
-    PRINT,INPUT, COND, FUNC, LOOP, TRUE, FALSE,CLASS,CLASSEND,COMMA,FUNCEND,CONDEND,COMMENT,
+    PRINT,INPUT, COND, FUNC, LOOP, TRUE, FALSE,CLASS,CLASSEND,COMMA,FUNCEND,CONDEND,LOOPEND,COMMENT,
     IDENT, INT, FLOAT, STRING,RETURN,OBJECT,DOT,
     ASSIGN, GT,LT,GE, LE, EQ, NEQ, REV,
     COLON, NEWLINE,CONTINUE,BREAK,
     PLUS,MINUS,MUL,DIV,MOD,
-    LPAREN,RPAREN,LBRACKET, RBRACKET,SEMI,
+    LPAREN,RPAREN,LBRACKET, RBRACKET,LBRACE,RBRACE,SEMI,
     ENDOFFILE
 };
 
 enum class CondType{ IF , ELSEIF , ELSE};
 
+//value points into the source text (or a literal), tokens never own memory
 struct Token {
     TokenType type;
-    std::string value;
+    std::string_view value;
     CondType condType;
+    size_t offset = 0;   // where the token starts in the source
+
+    std::string text() const { return std::string(value); }
 };
@@ -0,0 +1,357 @@
+#include "value.hpp"
+#include "ast.hpp"
+#include "dict.hpp"
+#include "number.hpp"
+#include "output.hpp"
+#include <algorithm>
+#include <cctype>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+StringObj::StringObj(Value l, Value r)
+    : Obj(ObjType::STRING),
+      length(l.asStringObj()->length + r.asStringObj()->length),
+      left(std::move(l)),
+      right(std::move(r)) {}
+
+//walks the rope with an explicit stack, a string built in a loop can be a rope thousands of levels deep
+void StringObj::flatten() const {
+    std::string out;
+    out.reserve(length);
+    std::vector<const StringObj *> pending{this};
+    while (!pending.empty()) {
+        const StringObj *s = pending.back();
+        pending.pop_back();
+        if (s->isRope()) {
+            pending.push_back(s->right.asStringObj());
+            pending.push_back(s->left.asStringObj());
+        } else {
+            out += s->chars;
+        }
+    }
+    chars = std::move(out);
+    left = Value();
+    right = Value();
+}
+
+void freeObject(Obj *obj) {
+    switch (obj->type) {
+    case ObjType::STRING: {
+        // ropes are freed iteratively for the same reason they are flattened iteratively
+        std::vector<StringObj *> doomed{static_cast<StringObj *>(obj)};
+        while (!doomed.empty()) {
+            StringObj *s = doomed.back();
+            doomed.pop_back();
+            for (Value *half : {&s->left, &s->right}) {
+                if (!half->isObj()) continue;
+                Obj *child = half->take();
+                if (--child->refCount == 0) doomed.push_back(static_cast<StringObj *>(child));
+            }
+            delete s;
+        }
+        break;
+    }
+    case ObjType::ARRAY: delete static_cast<ArrayObj *>(obj); break;
+    case ObjType::INSTANCE: delete static_cast<InstanceObj *>(obj); break;
+    case ObjType::FUNCTION: delete static_cast<FunctionObj *>(obj); break;
+    case ObjType::CLASS: delete static_cast<ClassObj *>(obj); break;
+    case ObjType::DICT: delete static_cast<DictObj *>(obj); break;
+    }
+}
+
+ArrayObj::ArrayObj(std::vector<Value> v) : Obj(ObjType::ARRAY), items(std::move(v)) {
+    for (const Value &item : items) nonNumbers += !item.isNumber();
+}
+
+static uint32_t nextShapeId = 1;
+
+ClassObj::ClassObj(std::string n) : Obj(ObjType::CLASS), name(std::move(n)) {
+    shapes.emplace_back(new Shape{nextShapeId++, this, {}, {}});
+}
+
+Shape *Shape::withField(Symbol name) {
+    auto it = transitions.find(name);
+    if (it != transitions.end()) return it->second;
+    Shape *next = new Shape{nextShapeId++, klass, slots, {}};
+    next->slots.emplace(name, (int)slots.size());
+    klass->shapes.emplace_back(next);
+    transitions.emplace(name, next);
+    return next;
+}
+
+Value makeClass(const ClassDef &def) {
+    auto klass = new ClassObj(def.name);
+    for (auto m : def.methods) klass->methods[m->symbol] = m;
+    return Value(klass);
+}
+
+Value getMember(InlineCache &ic, const InstanceObj &inst, Symbol name) {
+    if (ic.shapeId != inst.shape->id) {
+        ic = InlineCache();
+        auto it = inst.shape->slots.find(name);
+        if (it != inst.shape->slots.end()) ic.slot = it->second;
+        else ic.method = inst.getClass()->findMethod(name);
+        if (ic.slot < 0 && !ic.method) throw std::runtime_error("Unknown member: " + symbolName(name));
+        ic.shapeId = inst.shape->id;
+    }
+    if (ic.slot >= 0) return inst.fields[ic.slot];
+    return Value(new FunctionObj(ic.method));
+}
+
+void setMember(InlineCache &ic, InstanceObj &inst, Symbol name, Value v) {
+    if (ic.shapeId != inst.shape->id) {
+        ic = InlineCache();
+        auto it = inst.shape->slots.find(name);
+        if (it != inst.shape->slots.end()) {
+            ic.slot = it->second;
+        } else {
+            ic.slot = (int)inst.fields.size();
+            ic.next = inst.shape->withField(name);
+        }
+        ic.shapeId = inst.shape->id;
+    }
+    if (ic.next) {
+        inst.fields.push_back(std::move(v));
+        inst.shape = ic.next;
+    } else {
+        inst.fields[ic.slot] = std::move(v);
+    }
+}
+
+Value *fieldSlot(InlineCache &ic, InstanceObj &inst, Symbol name) {
+    if (ic.shapeId != inst.shape->id) {
+        ic = InlineCache();
+        auto it = inst.shape->slots.find(name);
+        if (it == inst.shape->slots.end()) throw std::runtime_error("Unknown field: " + symbolName(name));
+        ic.slot = it->second;
+        ic.shapeId = inst.shape->id;
+    }
+    if (ic.slot < 0 || ic.next) throw std::runtime_error("Unknown field: " + symbolName(name)); // cached by a method read or a field add
+    return &inst.fields[ic.slot];
+}
+
+InstanceObj &instanceOf(const Value &obj, const char *what) {
+    if (!obj.isInstance()) throw std::runtime_error(std::string("Tried to ") + what + " on non-object");
+    return *obj.asInstance();
+}
+
+ArrayObj *mutableArray(Value &slot) {
+    ArrayObj *arr = slot.asArray();
+    if (arr->refCount > 1) {
+        slot = makeArray(arr->items); // shared: copy once, the slot now owns the only reference
+        arr = slot.asArray();
+    }
+    return arr;
+}
+
+Value internString(const std::string &s) {
+    static std::unordered_map<std::string, Value> interned;
+    auto it = interned.find(s);
+    if (it != interned.end()) return it->second;
+    Value v = makeString(s);
+    interned.emplace(s, v);
+    return v;
+}
+
+Value charString(unsigned char c) {
+    static const std::vector<Value> chars = [] {
+        std::vector<Value> all;
+        all.reserve(256);
+        for (int i = 0; i < 256; ++i) all.push_back(makeString(std::string(1, (char)i)));
+        return all;
+    }();
+    return chars[c];
+}
+
+//below this size a copy is cheaper than keeping two halves around
+static const size_t ROPE_MIN_LENGTH = 64;
+
+Value concatStrings(const Value &a, const Value &b) {
+    StringObj *l = a.asStringObj();
+    StringObj *r = b.asStringObj();
+    if (r->length == 0) return a;
+    if (l->length == 0) return b;
+    if (l->length + r->length < ROPE_MIN_LENGTH) return makeString(l->str() + r->str());
+    return Value(new StringObj(a, b));
+}
+
+bool isTruthy(const Value &v) {
+    if (v.isBool()) return v.asBool();
+    if (v.isNumber()) return v.asNumber() != 0.0;
+    if (v.isString()) return v.asStringObj()->length != 0;
+    return true;
+}
+
+//an item inside an array or dict (simplest: only numbers/strings)
+static void printNumber(Output &out, double d) {
+    char buf[NUMBER_CHARS];
+    out.write(buf, formatNumber(buf, d));
+}
+
+//a value inside an array or dict: strings are quoted, nested containers printed in full.
+//open holds the containers being printed around item: dicts are shared, so one can hold itself
+//(d["me"] = d), and reaching one of those again prints [...] or {...} instead of going round forever
+static void printItem(Output &out, const Value &item, std::vector<const Obj *> &open) {
+    if (item.isNumber()) printNumber(out, item.asNumber());
+    else if (item.isString()) {
+        out.put('"');
+        out.write(item.asString());
+        out.put('"');
+    }
+    else if (item.isBool()) out.write(item.asBool() ? "true" : "false");
+    else if (item.isInstance()) out.write("<object>");
+    else if (item.isArray()) {
+        const ArrayObj *obj = item.asArray();
+        if (std::find(open.begin(), open.end(), obj) != open.end()) {
+            out.write("[...]");
+            return;
+        }
+        open.push_back(obj);
+        auto &arr = obj->items;
+        out.put('[');
+        for (size_t i = 0; i < arr.size(); ++i) {
+            printItem(out, arr[i], open);
+            if (i + 1 < arr.size()) out.write(", ");
+        }
+        out.put(']');
+        open.pop_back();
+    }
+    else if (item.isDict()) {
+        const DictObj *obj = item.asDict();
+        if (std::find(open.begin(), open.end(), obj) != open.end()) {
+            out.write("{...}");
+            return;
+        }
+        open.push_back(obj);
+        auto &entries = obj->entries;
+        out.put('{');
+        for (size_t i = 0; i < entries.size(); ++i) {
+            printItem(out, entries[i].key, open);
+            out.write(": ");
+            printItem(out, entries[i].value, open);
+            if (i + 1 < entries.size()) out.write(", ");
+        }
+        out.put('}');
+        open.pop_back();
+    }
+}
+
+//a plain newline, the Output decides when the text actually goes out
+void printValue(Output &out, const Value &val) {
+    if (val.isString()) out.write(val.asString());
+    else if (val.isBool()) out.write(val.asBool() ? "no_cap" : "cap");
+    else if (val.isNumber() || val.isInstance() || val.isArray() || val.isDict()) {
+        std::vector<const Obj *> open;
+        printItem(out, val, open);
+    }
+    else return;
+    out.put('\n');
+}
+
+//position of index in something of length n, negative indexes count from the end
+static size_t checkedIndex(const Value &index, size_t n, const char *outOfRange) {
+    if (!index.isNumber())
+        throw std::runtime_error("Index must be a number");
+    int i = static_cast<int>(index.asNumber());
+    if (i < 0) i = (int)n + i;
+    if (i < 0 || i >= (int)n) throw std::runtime_error(outOfRange);
+    return (size_t)i;
+}
+
+Value indexValue(const Value &target, const Value &index) {
+    if (target.isDict()) {
+        if (Value *v = target.asDict()->find(index)) return *v;
+        throw std::runtime_error("Key not found in dict");
+    }
+    if (!index.isNumber())
+        throw std::runtime_error("Index must be a number");
+
+    if (target.isArray()) {
+        auto &arr = target.asArray()->items;
+        return arr[checkedIndex(index, arr.size(), "Array index out of range")];
+    } else if (target.isString()) {
+        auto &s = target.asString();
+        return charString((unsigned char)s[checkedIndex(index, s.size(), "String index out of range")]);
+    }
+    throw std::runtime_error("Target is not indexable");
+}
+
+void assignIndex(Value &target, const Value &index, Value v) {
+    if (target.isDict()) {
+        target.asDict()->set(index, std::move(v));
+    } else if (target.isArray()) {
+        size_t i = checkedIndex(index, target.asArray()->items.size(), "Array index out of range");
+        mutableArray(target)->set(i, std::move(v));
+    } else {
+        throw std::runtime_error("Target does not support index assignment");
+    }
+}
+
+Value *elementSlot(Value &target, const Value &index) {
+    if (target.isDict()) {
+        if (Value *v = target.asDict()->find(index)) return v;
+        throw std::runtime_error("Key not found in dict");
+    }
+    if (!target.isArray()) throw std::runtime_error("Target does not support index assignment");
+    size_t i = checkedIndex(index, target.asArray()->items.size(), "Array index out of range");
+    return &mutableArray(target)->items[i];
+}
+
+bool isArrayMethod(Symbol name) {
+    return name == SYMBOL_PUSH || name == SYMBOL_POP;
+}
+
+Value callArrayMethod(Value &slot, Symbol name, const Value *args, size_t argc) {
+    if (argc != (name == SYMBOL_PUSH ? 1u : 0u))
+        throw std::runtime_error("Argument count mismatch in call to " + symbolName(name));
+    ArrayObj *arr = mutableArray(slot);
+    if (name == SYMBOL_PUSH) {
+        arr->push(args[0]);
+        return (double)arr->items.size();
+    }
+    if (arr->items.empty()) throw std::runtime_error("pop from an empty array");
+    return arr->pop();
+}
+
+Value logicalNot(const Value &v) {
+    if (v.isBool()) return !v.asBool();
+    if (v.isNumber()) return v.asNumber() == 0.0;
+    throw std::runtime_error("Invalid operand type for '!'");
+}
+
+Value negate(const Value &v) {
+    if (v.isNumber()) return -v.asNumber();
+    throw std::runtime_error("Invalid operand type for unary '-'");
+}
+
+Value concatValues(const std::string &op, const Value &L, const Value &R) {
+    if (op == "+" && L.isString() && R.isString()) {
+        return concatStrings(L, R);
+    }
+    if (op == "+" && L.isString() && R.isNumber()) {
+        return concatStrings(L, makeString(numberToString(R.asNumber())));
+    }
+    if (op == "+" && L.isNumber() && R.isString()) {
+        return concatStrings(makeString(numberToString(L.asNumber())), R);
+    }
+    throw std::runtime_error("Invalid operands for binary operator: " + op);
+}
+
+Value readInput(Output &out, const std::string &name) {
+    out.write("📝 spill ");
+    out.write(name);
+    out.write(": ");
+    out.flush(); // the prompt has to be out before waiting for the line
+    std::string s;
+    std::getline(std::cin, s);
+    if (!s.empty() && s.back() == '\r') s.pop_back(); // a line typed on windows or piped from a crlf file
+
+    // a number only when the whole line is one, blanks around it aside
+    std::string_view text = s;
+    while (!text.empty() && std::isspace((unsigned char)text.front())) text.remove_prefix(1);
+    while (!text.empty() && std::isspace((unsigned char)text.back())) text.remove_suffix(1);
+    double d;
+    if (parseNumber(text, d)) return d;
+    return makeString(s);
+}
@@ -0,0 +1,300 @@
+// src/value.hpp
+//runtime values shared by every engine (tree-walker and bytecode vm) so both print and compare the same way
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+#include <string>
+#include <vector>
+#include <memory>
+#include "symbol.hpp"
+
+class Value;
+class Output;
+struct FuncDef;
+struct ClassDef;
+
+enum class ObjType : uint8_t { STRING, ARRAY, INSTANCE, FUNCTION, CLASS, DICT };
+
+//header of everything a Value can point to, freed when the last Value referencing it goes away
+struct Obj {
+    uint32_t refCount = 0;
+    ObjType type;
+    explicit Obj(ObjType t) : type(t) {}
+};
+
+struct StringObj;
+struct ArrayObj;
+struct InstanceObj;
+struct FunctionObj;
+struct ClassObj;
+struct DictObj;
+
+void freeObject(Obj *obj);
+
+// A Value is one 64 bit word (NaN boxing):
+//   - any double is stored as is (NaNs are folded into the one NaN the cpu produces)
+//   - undefined / cap / no_cap are quiet NaNs with a small tag in the low bits
+//   - heap objects are quiet NaNs with the sign bit set and the pointer in the low 48 bits
+// Numbers and booleans never touch the allocator, copying an object Value only bumps its refcount.
+// "undefined" marks an unset variable slot, scripts never see it as a value.
+class Value {
+public:
+    Value() : bits(UNDEFINED_BITS) {}
+    Value(double d) {
+        if (d != d) d = std::numeric_limits<double>::quiet_NaN(); // keep NaN payloads out of our tag space
+        std::memcpy(&bits, &d, sizeof d);
+    }
+    Value(bool b) : bits(b ? TRUE_BITS : FALSE_BITS) {}
+    explicit Value(Obj *obj) : bits(SIGN_BIT | QNAN | (uint64_t)(uintptr_t)obj) { obj->refCount++; }
+    Value(const char *) = delete; // would silently turn into a bool
+
+    Value(const Value &other) : bits(other.bits) { retain(); }
+    Value(Value &&other) noexcept : bits(other.bits) { other.bits = UNDEFINED_BITS; }
+    Value &operator=(const Value &other) {
+        other.retain();
+        release();
+        bits = other.bits;
+        return *this;
+    }
+    Value &operator=(Value &&other) noexcept {
+        if (this != &other) {
+            release();
+            bits = other.bits;
+            other.bits = UNDEFINED_BITS;
+        }
+        return *this;
+    }
+    ~Value() { release(); }
+
+    bool isNumber() const { return (bits & QNAN) != QNAN; }
+    bool isBool() const { return (bits | 1) == TRUE_BITS; }
+    bool isUndefined() const { return bits == UNDEFINED_BITS; }
+    bool isObj() const { return (bits & (QNAN | SIGN_BIT)) == (QNAN | SIGN_BIT); }
+    bool isString() const { return isObjType(ObjType::STRING); }
+    bool isArray() const { return isObjType(ObjType::ARRAY); }
+    bool isInstance() const { return isObjType(ObjType::INSTANCE); }
+    bool isFunction() const { return isObjType(ObjType::FUNCTION); }
+    bool isClass() const { return isObjType(ObjType::CLASS); }
+    bool isDict() const { return isObjType(ObjType::DICT); }
+
+    double asNumber() const {
+        double d;
+        std::memcpy(&d, &bits, sizeof d);
+        return d;
+    }
+    bool asBool() const { return bits == TRUE_BITS; }
+    Obj *asObj() const { return (Obj *)(uintptr_t)(bits & ~(SIGN_BIT | QNAN)); }
+    const std::string &asString() const;
+    StringObj *asStringObj() const { return (StringObj *)asObj(); }
+    ArrayObj *asArray() const { return (ArrayObj *)asObj(); }
+    InstanceObj *asInstance() const { return (InstanceObj *)asObj(); }
+    FunctionObj *asFunction() const { return (FunctionObj *)asObj(); }
+    ClassObj *asClass() const { return (ClassObj *)asObj(); }
+    DictObj *asDict() const { return (DictObj *)asObj(); }
+
+    //the same bits mean the same value (a string literal is interned, so equal ones share bits too)
+    uint64_t raw() const { return bits; }
+
+private:
+    static constexpr uint64_t SIGN_BIT = 0x8000000000000000ull;
+    static constexpr uint64_t QNAN = 0x7ffc000000000000ull;
+    static constexpr uint64_t UNDEFINED_BITS = QNAN | 1;
+    static constexpr uint64_t FALSE_BITS = QNAN | 2;
+    static constexpr uint64_t TRUE_BITS = QNAN | 3;
+
+    uint64_t bits;
+
+    bool isObjType(ObjType t) const { return isObj() && asObj()->type == t; }
+    friend void freeObject(Obj *obj);
+    //hands the reference over to the caller without touching the refcount
+    Obj *take() {
+        Obj *obj = asObj();
+        bits = UNDEFINED_BITS;
+        return obj;
+    }
+    void retain() const {
+        if (isObj()) asObj()->refCount++;
+    }
+    void release() {
+        if (isObj()) {
+            Obj *obj = asObj();
+            if (--obj->refCount == 0) freeObject(obj);
+        }
+    }
+};
+
+static_assert(sizeof(Value) == 8, "Value must stay a single 64 bit word");
+
+// Strings are immutable. One made by + starts out as a rope that only remembers its two halves,
+// and is flattened into chars the first time the text is needed (bruh, indexing...), so building
+// a string piece by piece in a loop stays linear.
+struct StringObj : Obj {
+    size_t length;
+    mutable std::string chars;          // the text, valid once the string is flat
+    mutable Value left, right;          // halves of a rope that was not flattened yet
+    explicit StringObj(std::string s) : Obj(ObjType::STRING), length(s.size()), chars(std::move(s)) {}
+    StringObj(Value l, Value r);
+
+    bool isRope() const { return !left.isUndefined(); }
+    const std::string &str() const {
+        if (isRope()) flatten();
+        return chars;
+    }
+    void flatten() const;
+};
+
+// Arrays are shared by every Value holding them, so reading or passing one is O(1).
+// They are copy-on-write: code that changes an array must get it through mutableArray(), which
+// only copies while another Value still shares it, so a[i] = v and push/pop on an array only one
+// variable holds change it in place.
+// A number Value is the double itself, so an array of only numbers already is a packed array of
+// doubles in memory: numeric() tells those apart, the builtins then run over the items as raw doubles.
+// Items are changed through set/push/pop so that count stays right.
+struct ArrayObj : Obj {
+    std::vector<Value> items;
+    size_t nonNumbers = 0;  // items that are not numbers
+    explicit ArrayObj(std::vector<Value> v);
+
+    bool numeric() const { return nonNumbers == 0; }
+    void set(size_t i, Value v) {
+        nonNumbers += !v.isNumber();
+        nonNumbers -= !items[i].isNumber();
+        items[i] = std::move(v);
+    }
+    void push(Value v) {
+        nonNumbers += !v.isNumber();
+        items.push_back(std::move(v)); // amortized O(1), the vector grows geometrically
+    }
+    Value pop() {
+        Value v = std::move(items.back());
+        items.pop_back();
+        nonNumbers -= !v.isNumber();
+        return v;
+    }
+};
+
+// Hidden class of an instance: which field sits in which slot of InstanceObj::fields.
+// Instances of a class that got the same fields in the same order share one Shape, so a site
+// that has seen a shape once knows the slot (or the method) without hashing the name again.
+struct Shape {
+    uint32_t id;                                            // unique for the whole run, never reused
+    ClassObj *klass;
+    std::unordered_map<Symbol, int> slots;              // field name → slot
+    std::unordered_map<Symbol, Shape *> transitions;    // shape reached by adding one more field
+
+    Shape *withField(Symbol name);
+};
+
+//a rizz class at runtime: methods live here once instead of being copied into every instance
+struct ClassObj : Obj {
+    std::string name;
+    std::unordered_map<Symbol, FuncDef *> methods;        // nodes of the Script being run
+    std::vector<std::unique_ptr<Shape>> shapes;           // shapes[0] is the empty one new instances start with
+    explicit ClassObj(std::string n);
+
+    FuncDef *findMethod(Symbol name) const {
+        auto it = methods.find(name);
+        return it == methods.end() ? nullptr : it->second;
+    }
+};
+
+struct InstanceObj : Obj {
+    Value klass;                // keeps the class, and with it the shapes, alive
+    Shape *shape;
+    std::vector<Value> fields;  // laid out by shape
+    explicit InstanceObj(const Value &cls)
+        : Obj(ObjType::INSTANCE), klass(cls), shape(cls.asClass()->shapes[0].get()) {}
+    ClassObj *getClass() const { return klass.asClass(); }
+};
+
+// Monomorphic inline cache of one obj.name site: the last shape seen there and what name meant
+// for it. Shape ids start at 1 so a zeroed cache never hits.
+struct InlineCache {
+    uint32_t shapeId = 0;
+    int slot = -1;              // field slot, -1 when name is a method
+    FuncDef *method = nullptr;
+    Shape *next = nullptr;      // for obj.name = v adding a field: the shape after the add
+};
+
+//a method read through obj.name
+struct FunctionObj : Obj {
+    FuncDef *fn;
+    explicit FunctionObj(FuncDef *f) : Obj(ObjType::FUNCTION), fn(f) {}
+};
+
+inline const std::string &Value::asString() const { return asStringObj()->str(); }
+
+inline Value makeString(std::string s) { return Value(new StringObj(std::move(s))); }
+
+//the shared string object for a literal, equal literals get the same object
+Value internString(const std::string &s);
+
+//preallocated one character strings, what indexing a string returns
+Value charString(unsigned char c);
+
+//a + b for two strings: short results are copied, long ones become a rope
+Value concatStrings(const Value &a, const Value &b);
+inline Value makeArray(std::vector<Value> items) { return Value(new ArrayObj(std::move(items))); }
+
+//the array held by slot, ready to be changed in place: if another Value still shares it the slot
+//first gets its own copy, so the other holders keep seeing the old contents
+ArrayObj *mutableArray(Value &slot);
+
+//the runtime class for a rizz definition
+Value makeClass(const ClassDef &def);
+
+//obj.name: a field if the instance has one, else a method as a function value
+Value getMember(InlineCache &ic, const InstanceObj &inst, Symbol name);
+
+//the method obj.name(...) runs, nullptr when the class has none
+inline FuncDef *findMethod(InlineCache &ic, const InstanceObj &inst, Symbol name) {
+    if (ic.shapeId == inst.shape->id) return ic.method;
+    ic = InlineCache();
+    ic.method = inst.getClass()->findMethod(name);
+    ic.shapeId = inst.shape->id;
+    return ic.method;
+}
+
+//obj.name = v, the first assignment adds the field and moves the instance to the next shape
+void setMember(InlineCache &ic, InstanceObj &inst, Symbol name, Value v);
+
+//the instance obj.x is used on, what says what was tried for the error ("call method" gives
+//"Tried to call method on non-object")
+InstanceObj &instanceOf(const Value &obj, const char *what);
+
+//condition check used by bet/noFam: numbers are true when non zero, strings when non empty
+bool isTruthy(const Value &v);
+
+//what bruh prints for a value, newline included
+void printValue(Output &out, const Value &v);
+
+//arr[i] and str[i], negative indexes count from the end, and dict[key]
+Value indexValue(const Value &target, const Value &index);
+
+//target[index] = v, target is where the container is stored: an array is changed in place unless
+//another Value shares it
+void assignIndex(Value &target, const Value &index, Value v);
+
+//the item target[index] is stored in, for changing what is inside it (the a[i] of a[i][j] = v).
+//A shared array is copied first. Whatever goes back into the item must keep its kind (an array
+//stays an array), else ArrayObj::nonNumbers goes stale.
+Value *elementSlot(Value &target, const Value &index);
+
+//a.push(v) / a.pop() on the array stored in slot: push gives the new length, pop the removed item
+bool isArrayMethod(Symbol name);
+Value callArrayMethod(Value &slot, Symbol name, const Value *args, size_t argc);
+
+//the slot of field obj.name for changing what is inside it, like elementSlot
+Value *fieldSlot(InlineCache &ic, InstanceObj &inst, Symbol name);
+
+//!v on a bool or number, -v on a number
+Value logicalNot(const Value &v);
+Value negate(const Value &v);
+
+//fallback for + on strings ("a" + "b", "a" + 1), throws for anything else
+Value concatValues(const std::string &op, const Value &L, const Value &R);
+
+//spill: prompts for name on out and reads a line, numbers come back as numbers
+Value readInput(Output &out, const std::string &name);
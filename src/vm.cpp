@@ -0,0 +1,447 @@
+// src/vm.cpp
+//the dispatch loop lives here, everything hot is kept in locals (ip, sp, slots) and only written back on calls
+#include "vm.hpp"
+#include "dict.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+
+VM::VM(Output &out) : out(out), stack(new Value[STACK_START]) {
+    sp = stack.get();
+    frames.reserve(64);
+}
+
+const Function *VM::compiledFunction(const FuncDef *def) const {
+    if (!def) return nullptr;
+    auto it = program->compiled.find(def);
+    return it == program->compiled.end() ? nullptr : it->second;
+}
+
+//what receiver.name(...) runs
+const Function *VM::methodFor(SiteCache &site, const Value &receiver, int name) {
+    InstanceObj &instance = instanceOf(receiver, "call method");
+    if (site.ic.shapeId != instance.shape->id)
+        site.method = compiledFunction(findMethod(site.ic, instance, program->symbols[name]));
+    if (!site.method) throw std::runtime_error("Unknown method: " + program->names[name]);
+    return site.method;
+}
+
+//what a variable no value was assigned to reads as: the drip of that name, if there is one
+const Value &VM::unsetVariable(int name) const {
+    if (drips[name].isUndefined()) throw std::runtime_error("Undefined variable: " + program->names[name]);
+    return drips[name];
+}
+
+//walks to the slot of place, operand points at its operands on the stack
+Value &VM::placeSlot(const Function *fn, const Place &place, Value *slots, const Value *operand) {
+    Value *slot;
+    if (place.root == Place::LOCAL) {
+        slot = &slots[place.id];
+        if (slot->isUndefined()) {
+            // not assigned yet in this call: starts as the global it shadows
+            int name = fn->localNames[place.id];
+            *slot = globals[name].isUndefined() ? unsetVariable(name) : globals[name];
+        }
+    } else if (place.root == Place::GLOBAL) {
+        slot = &globals[place.id];
+        if (slot->isUndefined()) *slot = unsetVariable(place.id);
+    } else {
+        InstanceObj &obj = instanceOf(*operand++, "access member");
+        slot = fieldSlot(fn->caches[place.cache].ic, obj, program->symbols[place.id]);
+    }
+    for (int i = 0; i < place.depth; ++i) slot = elementSlot(*slot, *operand++);
+    return *slot;
+}
+
+//the arguments are already on the stack, they become the first slots of the new frame
+void VM::pushFrame(const Function *fn, int argc, Value *returnTo, const Value &self) {
+    if (argc != fn->arity)
+        throw std::runtime_error("Argument count mismatch in call to " + fn->name);
+    Value *slots = sp - argc;
+    size_t numLocals = fn->localNames.size();
+    size_t needed = (slots - stack.get()) + numLocals + fn->maxStack;
+    if (frames.size() >= FRAMES_MAX || needed > STACK_MAX)
+        throw std::runtime_error("Stack overflow in call to " + fn->name);
+    if (needed > stackSize) {
+        // self may live on the stack that is about to move
+        Value keep = self;
+        ptrdiff_t returnAt = returnTo - stack.get();
+        growStack(needed);
+        pushFrame(fn, argc, stack.get() + returnAt, keep);
+        return;
+    }
+
+    for (Value *v = sp; v < slots + numLocals; ++v) *v = Value();
+    if (fn->selfSlot >= 0 && self.isInstance()) slots[fn->selfSlot] = self;
+    sp = slots + numLocals;
+    frames.push_back({fn, fn->chunk.code.data(), slots, returnTo});
+}
+
+//moves the stack to one at least needed values big, every pointer into it moves along
+void VM::growStack(size_t needed) {
+    size_t size = stackSize;
+    while (size < needed) size *= 2;
+    size = std::min(size, STACK_MAX);
+    std::unique_ptr<Value[]> bigger(new Value[size]);
+    Value *from = stack.get();
+    std::move(from, sp, bigger.get());
+    for (CallFrame &frame : frames) {
+        frame.slots = bigger.get() + (frame.slots - from);
+        frame.returnTo = bigger.get() + (frame.returnTo - from);
+    }
+    sp = bigger.get() + (sp - from);
+    stack = std::move(bigger);
+    stackSize = size;
+}
+
+void VM::run(const Program &prog) {
+    program = &prog;
+    globals.assign(prog.names.size(), Value());
+    functions.assign(prog.names.size(), nullptr);
+    drips.assign(prog.names.size(), Value());
+    classes.assign(prog.names.size(), Value());
+
+    sp = stack.get();
+    frames.clear();
+    pushFrame(prog.script, 0, sp, Value());
+    execute(0);
+}
+
+//a drip called by a builtin like map runs in a dispatch loop of its own, on top of the caller's frames
+Value VM::call(FuncDef *def, const Value *args, size_t argc) {
+    size_t needed = (sp - stack.get()) + argc;
+    if (needed > STACK_MAX) throw std::runtime_error("Stack overflow in call to " + def->name);
+    if (needed > stackSize) growStack(needed);
+    for (size_t i = 0; i < argc; ++i) *sp++ = args[i];
+    size_t floor = frames.size();
+    pushFrame(compiledFunction(def), (int)argc, sp - argc, Value());
+    execute(floor);
+    return std::move(*--sp);
+}
+
+//runs the top frame until returning from it leaves floor frames
+void VM::execute(size_t floor) {
+    const Program &prog = *program;
+    const Function *fn;
+    const uint8_t *ip;
+    const Value *constants;
+    Value *slots;
+
+#define READ16() (ip += 2, (int)(ip[-2] | (ip[-1] << 8)))
+#define READ24() (ip += 3, (int)(ip[-3] | (ip[-2] << 8) | (ip[-1] << 16)))
+#define READ32() (ip += 4, (int)((uint32_t)ip[-4] | ((uint32_t)ip[-3] << 8) | ((uint32_t)ip[-2] << 16) | ((uint32_t)ip[-1] << 24)))
+#define LOAD_FRAME()                                   \
+    do {                                               \
+        fn = frames.back().fn;                         \
+        ip = frames.back().ip;                         \
+        slots = frames.back().slots;                   \
+        constants = fn->chunk.constants.data();        \
+    } while (0)
+    LOAD_FRAME();
+#define NUMERIC_OP(opName, expr)                                               \
+    do {                                                                       \
+        Value &L = sp[-2];                                                     \
+        Value &R = sp[-1];                                                     \
+        if (L.isNumber() && R.isNumber()) {                                    \
+            double l = L.asNumber();                                           \
+            double r = R.asNumber();                                           \
+            L = Value(expr);                                                   \
+        } else {                                                               \
+            L = concatValues(opName, L, R);                                    \
+            R = Value();                                                       \
+        }                                                                      \
+        --sp;                                                                  \
+    } while (0)
+
+    for (;;) {
+        switch ((OpCode)*ip++) {
+        case OP_CONSTANT:
+            *sp++ = constants[READ16()];
+            break;
+
+        case OP_CONSTANT_LONG:
+            *sp++ = constants[READ24()];
+            break;
+
+        case OP_POP:
+            *--sp = Value();
+            break;
+
+        case OP_GET_GLOBAL: {
+            int name = READ16();
+            *sp++ = globals[name].isUndefined() ? unsetVariable(name) : globals[name];
+            break;
+        }
+
+        case OP_SET_GLOBAL:
+            globals[READ16()] = std::move(*--sp);
+            break;
+
+        case OP_GET_LOCAL: {
+            int slot = READ16();
+            const Value *v = &slots[slot];
+            // not assigned yet in this call: read the global it shadows, like the tree-walker does
+            if (v->isUndefined()) {
+                int name = fn->localNames[slot];
+                v = &globals[name];
+                if (v->isUndefined()) v = &unsetVariable(name);
+            }
+            *sp++ = *v;
+            break;
+        }
+
+        case OP_SET_LOCAL:
+            slots[READ16()] = std::move(*--sp);
+            break;
+
+        case OP_ADD: NUMERIC_OP("+", l + r); break;
+        case OP_SUB: NUMERIC_OP("-", l - r); break;
+        case OP_MUL: NUMERIC_OP("*", l * r); break;
+        case OP_DIV: NUMERIC_OP("/", l / r); break;
+        case OP_MOD: NUMERIC_OP("%", std::fmod(l, r)); break;
+        case OP_GT:  NUMERIC_OP(">", l > r); break;
+        case OP_LT:  NUMERIC_OP("<", l < r); break;
+        case OP_GE:  NUMERIC_OP(">=", l >= r); break;
+        case OP_LE:  NUMERIC_OP("<=", l <= r); break;
+        case OP_EQ:  NUMERIC_OP("==", l == r); break;
+        case OP_NEQ: NUMERIC_OP("!=", l != r); break;
+
+        case OP_NOT: {
+            sp[-1] = logicalNot(sp[-1]);
+            break;
+        }
+
+        case OP_NEGATE: {
+            sp[-1] = negate(sp[-1]);
+            break;
+        }
+
+        case OP_JUMP: {
+            int offset = READ32();
+            ip += offset;
+            break;
+        }
+
+        case OP_JUMP_IF_FALSE: {
+            int offset = READ32();
+            Value cond = std::move(*--sp);
+            if (!isTruthy(cond)) ip += offset;
+            break;
+        }
+
+        case OP_LOOP: {
+            int offset = READ32();
+            ip -= offset;
+            break;
+        }
+
+        case OP_FOR_PREP: {
+            int offset = READ32();
+            if (!sp[-3].isNumber() || !sp[-2].isNumber() || !sp[-1].isNumber())
+                throw std::runtime_error("Loop bounds must be numbers");
+            double i = sp[-3].asNumber();
+            double limit = sp[-2].asNumber();
+            double by = sp[-1].asNumber();
+            if (by == 0.0) throw std::runtime_error("Loop step can't be 0");
+            if (by > 0 ? i < limit : i > limit) *sp++ = i;
+            else ip += offset;
+            break;
+        }
+
+        case OP_FOR_LOOP: {
+            int offset = READ32();
+            double by = sp[-1].asNumber();
+            double limit = sp[-2].asNumber();
+            double i = sp[-3].asNumber() + by;
+            sp[-3] = i;
+            if (by > 0 ? i < limit : i > limit) {
+                *sp++ = i;
+                ip -= offset;
+            }
+            break;
+        }
+
+        case OP_PRINT: {
+            Value v = std::move(*--sp);
+            printValue(out, v);
+            break;
+        }
+
+        case OP_INPUT:
+            *sp++ = readInput(out, prog.names[READ16()]);
+            break;
+
+        case OP_INDEX: {
+            Value result = indexValue(sp[-2], sp[-1]);
+            *--sp = Value();
+            sp[-1] = std::move(result);
+            break;
+        }
+
+        case OP_SET_INDEX: {
+            assignIndex(sp[-3], sp[-2], std::move(sp[-1]));
+            for (int i = 0; i < 3; ++i) *--sp = Value();
+            break;
+        }
+
+        case OP_SET_ELEMENT: {
+            const Place &place = fn->places[READ16()];
+            Value *operands = sp - 2 - place.operands();
+            assignIndex(placeSlot(fn, place, slots, operands), sp[-2], std::move(sp[-1]));
+            while (sp > operands) *--sp = Value();
+            break;
+        }
+
+        case OP_ARRAY: {
+            int count = READ16();
+            std::vector<Value> vals(std::make_move_iterator(sp - count), std::make_move_iterator(sp));
+            sp -= count;
+            *sp++ = makeArray(std::move(vals));
+            break;
+        }
+
+        case OP_DICT: {
+            int count = READ16();
+            Value dict = makeDict();
+            for (Value *pair = sp - 2 * count; pair < sp; pair += 2) dict.asDict()->set(pair[0], std::move(pair[1]));
+            for (int i = 0; i < 2 * count; ++i) *--sp = Value();
+            *sp++ = std::move(dict);
+            break;
+        }
+
+        case OP_CALL: {
+            int name = READ16();
+            int argc = *ip++;
+            bool calleeLocal = *ip++;
+            int calleeSlot = READ16();
+            frames.back().ip = ip;
+            const Value &calleeVar = calleeLocal ? slots[calleeSlot] : globals[calleeSlot];
+            if (const Function *callee = functions[name]) {
+                pushFrame(callee, argc, sp - argc, Value());
+            } else if (calleeVar.isFunction()) {
+                pushFrame(compiledFunction(calleeVar.asFunction()->fn), argc, sp - argc, Value());
+            } else if (const Function *init = calleeVar.isInstance()
+                           ? compiledFunction(calleeVar.asInstance()->getClass()->findMethod(SYMBOL_INIT)) : nullptr) {
+                Value instance = calleeVar;
+                pushFrame(init, argc, sp - argc, instance);
+            } else if (Builtin builtin = findBuiltin(prog.symbols[name])) {
+                Value result = builtin(sp - argc, argc, *this);
+                while (argc-- > 0) *--sp = Value();
+                *sp++ = std::move(result);
+            } else {
+                throw std::runtime_error("Undefined lol: " + prog.names[name]);
+            }
+            LOAD_FRAME();
+            break;
+        }
+
+        case OP_INVOKE: {
+            int name = READ16();
+            int argc = *ip++;
+            SiteCache &site = fn->caches[READ16()];
+            Value &receiver = sp[-argc - 1];
+            if (receiver.isArray() && isArrayMethod(prog.symbols[name])) {
+                // push/pop on a temporary array, e.g. f().pop()
+                Value result = callArrayMethod(receiver, prog.symbols[name], sp - argc, argc);
+                while (sp > &receiver) *--sp = Value();
+                *sp++ = std::move(result);
+                break;
+            }
+            const Function *method = methodFor(site, receiver, name);
+            frames.back().ip = ip;
+            pushFrame(method, argc, &receiver, receiver);
+            LOAD_FRAME();
+            break;
+        }
+
+        case OP_PLACE_INVOKE: {
+            const Place &place = fn->places[READ16()];
+            int name = READ16();
+            int argc = *ip++;
+            SiteCache &site = fn->caches[READ16()];
+            Value *operands = sp - argc - place.operands();
+            Value &slot = placeSlot(fn, place, slots, operands);
+            if (slot.isArray()) {
+                Value result = callArrayMethod(slot, prog.symbols[name], sp - argc, argc);
+                while (sp > operands) *--sp = Value();
+                *sp++ = std::move(result);
+                break;
+            }
+            // an object with its own push: the receiver goes where the operands were, under the arguments
+            Value receiver = slot;
+            if (place.operands() == 0) {
+                std::move_backward(operands, sp, sp + 1);
+                ++sp;
+            } else {
+                Value *end = std::move(sp - argc, sp, operands + 1);
+                while (sp > end) *--sp = Value();
+            }
+            operands[0] = std::move(receiver);
+            const Function *method = methodFor(site, operands[0], name);
+            frames.back().ip = ip;
+            pushFrame(method, argc, operands, operands[0]);
+            LOAD_FRAME();
+            break;
+        }
+
+        case OP_GET_MEMBER: {
+            Symbol member = prog.symbols[READ16()];
+            SiteCache &site = fn->caches[READ16()];
+            Value &obj = sp[-1];
+            obj = getMember(site.ic, instanceOf(obj, "access member"), member);
+            break;
+        }
+
+        case OP_SET_MEMBER: {
+            Symbol member = prog.symbols[READ16()];
+            SiteCache &site = fn->caches[READ16()];
+            setMember(site.ic, instanceOf(sp[-2], "set member"), member, std::move(sp[-1]));
+            sp -= 2;
+            sp[0] = Value();
+            sp[1] = Value();
+            break;
+        }
+
+        case OP_NEW: {
+            int name = READ16();
+            if (!classes[name].isClass()) throw std::runtime_error("Class not found: " + prog.names[name]);
+            *sp++ = Value(new InstanceObj(classes[name]));
+            break;
+        }
+
+        case OP_DEFINE_FUNC: {
+            const Function *def = prog.functions[READ16()].get();
+            functions[def->nameId] = def;
+            drips[def->nameId] = Value(new FunctionObj(def->def));
+            break;
+        }
+
+        case OP_DEFINE_CLASS: {
+            int name = READ16();
+            classes[name] = makeClass(*prog.classes[READ16()]);
+            break;
+        }
+
+        case OP_RETURN: {
+            Value result = std::move(*--sp);
+            Value *returnTo = frames.back().returnTo;
+            frames.pop_back();
+            while (sp > returnTo) *--sp = Value(); // drop the frame's locals and the receiver
+            *sp++ = std::move(result);
+            if (frames.size() == floor) return;
+            LOAD_FRAME();
+            break;
+        }
+
+        default:
+            throw std::runtime_error("Unknown opcode in vm");
+        }
+    }
+
+#undef NUMERIC_OP
+#undef LOAD_FRAME
+#undef READ32
+#undef READ24
+#undef READ16
+}
@@ -0,0 +1,49 @@
+// src/vm.hpp
+//stack based virtual machine running the bytecode made by the Compiler
+#pragma once
+#include "builtins.hpp"
+#include "bytecode.hpp"
+#include "output.hpp"
+#include <memory>
+#include <vector>
+
+class VM : DripCaller {
+public:
+    explicit VM(Output &out);
+    void run(const Program &program);
+
+private:
+    struct CallFrame {
+        const Function *fn;
+        const uint8_t *ip;
+        Value *slots;       // first local of the frame
+        Value *returnTo;    // where the result goes once the frame returns
+    };
+
+    // the stack starts at STACK_START values and doubles when a call needs more, up to STACK_MAX;
+    // the limits only stop runaway recursion, a deep one that ends runs fine
+    static constexpr size_t STACK_START = 1 << 16;
+    static constexpr size_t STACK_MAX = 1 << 25;
+    static constexpr size_t FRAMES_MAX = 1 << 21;
+
+    Output &out;
+    std::unique_ptr<Value[]> stack;
+    size_t stackSize = STACK_START;
+    Value *sp = nullptr;
+    std::vector<CallFrame> frames;
+
+    const Program *program = nullptr;
+    std::vector<Value> globals;                      // indexed by name id, undefined until assigned
+    std::vector<const Function *> functions;         // indexed by name id
+    std::vector<Value> drips;                        // FunctionObj of functions[id], what an unset name reads as
+    std::vector<Value> classes;                      // ClassObj, indexed by name id
+
+    void execute(size_t floor);
+    Value call(FuncDef *def, const Value *args, size_t argc) override;
+    void pushFrame(const Function *fn, int argc, Value *returnTo, const Value &self);
+    void growStack(size_t needed);
+    const Function *compiledFunction(const FuncDef *def) const;
+    const Function *methodFor(SiteCache &site, const Value &receiver, int name);
+    const Value &unsetVariable(int name) const;
+    Value &placeSlot(const Function *fn, const Place &place, Value *slots, const Value *operand);
+};
@@ -0,0 +1,40 @@
+# tests/generated_parity.cmake
+# scripts too big to keep in the repo are written out here, then checked by run_parity.cmake like
+# the ones in tests/parity:
+#   cmake -DRIZZ=<rizz binary> -DNAME=<script below> -DWORK=<scratch dir> -P generated_parity.cmake
+set(dir "${WORK}/generated")
+file(MAKE_DIRECTORY "${dir}")
+configure_file("${CMAKE_CURRENT_LIST_DIR}/empty.input" "${WORK}/empty.input" COPYONLY)
+
+if(NAME STREQUAL "many_constants")
+    # more distinct constants than a 16 bit operand can index, plus a repeated one that is stored once
+    # built a thousand lines at a time, appending each line to one long string takes cmake ages
+    set(script "s = 0\n")
+    foreach(hi RANGE 69)
+        set(block "")
+        foreach(lo RANGE 999)
+            math(EXPR i "${hi} * 1000 + ${lo}")
+            string(APPEND block "s = s + ${i}.5\nt = 1.25\n")
+        endforeach()
+        string(APPEND script "${block}")
+    endforeach()
+    string(APPEND script "bruh s\nbruh t\n")
+    set(expected "2.45e+09\n1.25\n")
+elseif(NAME STREQUAL "long_jumps")
+    # loop bodies and branches longer than a 16 bit jump can cross
+    set(body "")
+    foreach(i RANGE 7999)
+        string(APPEND body "    t = t + ${i}\n")
+    endforeach()
+    set(script "t = 0\nloop i = 0, 3:\n${body}    bet i == 1:\n        yeet\n    yikes\nperiodt\nbruh t\n")
+    string(APPEND script "n = 0\nloop n < 2:\n    n = n + 1\n${body}periodt\nbruh t\n")
+    string(APPEND script "bet t < 0:\n${body}forReal:\n    bruh \"past it\"\nyikes\n")
+    set(expected "95988000\n159980000\npast it\n")
+else()
+    message(FATAL_ERROR "no generated script called ${NAME}")
+endif()
+
+file(WRITE "${dir}/${NAME}.rizz" "${script}")
+file(WRITE "${dir}/${NAME}.expected" "${expected}")
+set(SCRIPT "${dir}/${NAME}.rizz")
+include("${CMAKE_CURRENT_LIST_DIR}/run_parity.cmake")
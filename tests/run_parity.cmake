@@ -0,0 +1,45 @@
+# tests/run_parity.cmake
+# runs one script under every engine and checks each prints exactly NAME.expected:
+#   cmake -DRIZZ=<rizz binary> -DSCRIPT=<x.rizz> -DWORK=<scratch dir> -P run_parity.cmake
+# stdin comes from NAME.input when there is one. Every engine runs once without the cache, then the
+# script is run cold once to write its .rizzc and every engine again on the warm cache, which has to
+# be a hit and print the same.
+get_filename_component(name "${SCRIPT}" NAME_WE)
+get_filename_component(dir "${SCRIPT}" DIRECTORY)
+file(READ "${dir}/${name}.expected" expected)
+set(input "${dir}/${name}.input")
+if(NOT EXISTS "${input}")
+    set(input "${dir}/../empty.input")
+endif()
+
+# the cache file lands next to the script, so run a copy in the build tree
+file(MAKE_DIRECTORY "${WORK}")
+set(copy "${WORK}/${name}.rizz")
+configure_file("${SCRIPT}" "${copy}" COPYONLY)
+file(REMOVE "${WORK}/${name}.rizzc")
+
+set(failed "")
+function(run_engine engine label)
+    execute_process(COMMAND "${RIZZ}" --engine=${engine} ${ARGN} "${copy}"
+                    INPUT_FILE "${input}" OUTPUT_VARIABLE out ERROR_VARIABLE err)
+    if(NOT out STREQUAL expected)
+        message("---- ${label} printed:\n${out}\n---- expected:\n${expected}")
+        set(failed "${failed} ${label}" PARENT_SCOPE)
+    endif()
+    if(ARGN MATCHES "--cache-stats" AND NOT err MATCHES "\\[cache\\] hit")
+        message("---- ${label} did not load the cache: ${err}")
+        set(failed "${failed} ${label}" PARENT_SCOPE)
+    endif()
+endfunction()
+
+foreach(engine ast vm closure)
+    run_engine(${engine} ${engine} --no-cache)
+endforeach()
+run_engine(ast "ast (cold cache)")
+foreach(engine ast vm closure)
+    run_engine(${engine} "${engine} (warm cache)" --cache-stats)
+endforeach()
+
+if(failed)
+    message(FATAL_ERROR "${name}: wrong output from${failed}")
+endif()